@@ -0,0 +1,674 @@
+/****************************************************************************
+**
+** Copyright (C) 2018 Brian Hill
+** All rights reserved.
+**
+** License Agreement
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** Software Author: Brian Hill <brian.hill@glowfish.ca>
+**
+** Summary: Benchmarks of the radial clock paint, color and hit test paths
+**
+****************************************************************************/
+
+#include "radial_clock.h"
+#include "time_source.h"
+#include "ring_rasterizer.h"
+#include "zone_table.h"
+
+#include <QApplication>
+#include <QMouseEvent>
+#include <QPainter>
+#include <QtTest>
+#include <map>
+#include <vector>
+
+namespace {
+    // The instant every benchmark shows unless it sets its own.
+    const QDateTime cInstant(QDate(2019, 6, 15), QTime(10, 20, 30, 250), Qt::UTC);
+
+    /************************************************************************
+    ** The rings a clock lays out on a 4K face: seven rings from a fifth of
+    ** the face out to its edge, one percent apart.
+    ************************************************************************/
+    const QSize c4K(3840, 2160);
+    const int cRingCount = 7;
+    const int cRingBase = 420;
+    const int cRingThick = 76;
+    const int cRingSpace = 21;
+    const qreal cRingAngles[cRingCount] = { 123.5, 37, 300, 5, 190.25, 271, 64 };
+
+    int ringRadius(int i) { return cRingBase + i*(cRingThick + cRingSpace); }
+
+    QColor ringColor(int i) { return QColor::fromHsv(i*50, 200, 220); }
+
+    // Zones on either side of UTC, with and without daylight saving time
+    // and with offsets that are not whole hours.
+    const char *cZones[] = { "America/New_York", "Europe/Berlin", "Asia/Kolkata",
+                             "Australia/Adelaide", "Pacific/Chatham", "UTC" };
+    const int cZoneCount = 6;
+
+    /************************************************************************
+    ** The center text as the clock drew it before it kept static text:
+    ** formatted and laid out again on every paint.
+    ************************************************************************/
+    class DrawTextClock : public QWidget
+    {
+    protected:
+        void paintEvent(QPaintEvent *)
+        {
+            QDateTime now = RadialClock::timeSource()->currentDateTime();
+            QString delim = (now.time().second() % 2 == 0) ? ":" : " ";
+            QString pattern = "hh"+delim+"mm"+delim+"ss";
+            QPainter painter(this);
+            painter.setRenderHint(QPainter::Antialiasing);
+            painter.setPen(RadialClock::cBlack);
+            painter.drawText(rect(), Qt::AlignCenter,
+                             now.date().toString("ddd d, MMM") + QString("\n") + now.time().toString(pattern));
+        }
+    };
+
+    /************************************************************************
+    ** Show only the rings of the named set, none for any other name.
+    ************************************************************************/
+    void setRings(RadialClock &clock, const QString &set)
+    {
+        bool all = (set == "all");
+        bool time = all || (set == "time");
+        bool days = all || (set == "days");
+        clock.setSeconds(time || set == "seconds");
+        clock.setMinutes(time);
+        clock.setHours(time);
+        clock.setWeekDays(days);
+        clock.setMonthDays(days);
+        clock.setYearDays(days);
+        clock.setMonths(all);
+    }
+
+    /************************************************************************
+    ** Show the clock and wait until it is exposed, so it has joined the
+    ** ticker and read the time.
+    ************************************************************************/
+    bool showClock(QWidget &widget, const QSize &size)
+    {
+        widget.resize(size);
+        widget.show();
+        return QTest::qWaitForWindowExposed(&widget);
+    }
+}
+
+class BenchRadialClock : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void paint_data();
+    void paint();
+    void processColors_data();
+    void processColors();
+    void getColors_data();
+    void getColors();
+    void blips_data();
+    void blips();
+    void timeCodeAt();
+    void mousePress_data();
+    void mousePress();
+    void ringFill_data();
+    void ringFill();
+    void rasterizer_data();
+    void rasterizer();
+    void centerText_data();
+    void centerText();
+    void zonedSnapshot_data();
+    void zonedSnapshot();
+    void zonedClocks();
+    void simulatedYear_data();
+    void simulatedYear();
+    void rollover_data();
+    void rollover();
+};
+
+void BenchRadialClock::initTestCase()
+{
+    // A time that stands still keeps the ticker from repainting behind the
+    // benchmarks' back.
+    RadialClock::setTimeSource(new FixedTimeSource(cInstant));
+}
+
+void BenchRadialClock::cleanupTestCase()
+{
+    RadialClock::setTimeSource(NULL);
+}
+
+/************************************************************************
+** A full repaint, either from the cached layer of the outer rings or
+** (cold) with the layer and the colors rebuilt.
+************************************************************************/
+void BenchRadialClock::paint_data()
+{
+    QTest::addColumn<QSize>("size");
+    QTest::addColumn<QString>("rings");
+    QTest::addColumn<bool>("cold");
+
+    const int sides[] = { 64, 256, 1024 };
+    const char *sets[] = { "all", "time", "days", "seconds" };
+    for(int i = 0; i < 3; i++) {
+        for(int j = 0; j < 4; j++) {
+            for(int cold = 0; cold < 2; cold++) {
+                QString name = QString("%1/%2/%3").arg(sides[i]).arg(sets[j]).arg(cold ? "cold" : "cached");
+                QTest::newRow(qPrintable(name)) << QSize(sides[i], sides[i]) << QString(sets[j]) << bool(cold);
+            }
+        }
+    }
+}
+
+void BenchRadialClock::paint()
+{
+    QFETCH(QSize, size);
+    QFETCH(QString, rings);
+    QFETCH(bool, cold);
+
+    RadialClock clock;
+    setRings(clock, rings);
+    QVERIFY(showClock(clock, size));
+    clock.repaint();
+
+    if (cold) {
+        QBENCHMARK {
+            clock.setInnerColor(clock.innerColor());
+            clock.repaint();
+        }
+    } else {
+        QBENCHMARK {
+            clock.repaint();
+        }
+    }
+}
+
+/************************************************************************
+** Settling the ring colors after the palette changed.
+************************************************************************/
+void BenchRadialClock::processColors_data()
+{
+    QTest::addColumn<bool>("rainbow");
+    QTest::newRow("gradient") << false;
+    QTest::newRow("rainbow") << true;
+}
+
+void BenchRadialClock::processColors()
+{
+    QFETCH(bool, rainbow);
+
+    RadialClock clock;
+    QBENCHMARK {
+        clock.setRainbow(rainbow);
+        clock.processColors();
+    }
+}
+
+void BenchRadialClock::getColors_data()
+{
+    QTest::addColumn<bool>("rainbow");
+    QTest::newRow("gradient") << false;
+    QTest::newRow("rainbow") << true;
+}
+
+void BenchRadialClock::getColors()
+{
+    QFETCH(bool, rainbow);
+
+    RadialClock clock;
+    std::vector<QColor> reference;
+    if (rainbow) {
+        reference.push_back(Qt::red);
+        reference.push_back(QColor(255, 127, 0));
+        reference.push_back(Qt::yellow);
+        reference.push_back(Qt::green);
+        reference.push_back(Qt::blue);
+        reference.push_back(QColor(75, 0, 130));
+        reference.push_back(QColor(148, 0, 211));
+    } else {
+        reference.push_back(clock.innerColor());
+        reference.push_back(clock.outerColor());
+    }
+
+    std::vector<QColor> colors;
+    QBENCHMARK {
+        colors.clear();
+        clock.getColors(reference, RadialClock::InvalidTimeCode, colors);
+    }
+    QCOMPARE(int(colors.size()), int(RadialClock::InvalidTimeCode));
+}
+
+/************************************************************************
+** The blip decisions inside the blip window of the last second before
+** each kind of rollover.
+************************************************************************/
+void BenchRadialClock::blips_data()
+{
+    QTest::addColumn<QDateTime>("instant");
+
+    QTime last(23, 59, 59, 900);
+    QTest::newRow("midMinute") << QDateTime(QDate(2019, 6, 15), QTime(10, 20, 30, 900), Qt::UTC);
+    QTest::newRow("endOfMinute") << QDateTime(QDate(2019, 6, 15), QTime(10, 20, 59, 900), Qt::UTC);
+    QTest::newRow("endOfHour") << QDateTime(QDate(2019, 6, 15), QTime(10, 59, 59, 900), Qt::UTC);
+    QTest::newRow("endOfDay") << QDateTime(QDate(2019, 6, 15), last, Qt::UTC);
+    QTest::newRow("endOfWeek") << QDateTime(QDate(2019, 6, 16), last, Qt::UTC);
+    QTest::newRow("endOfMonth") << QDateTime(QDate(2019, 4, 30), last, Qt::UTC);
+    QTest::newRow("endOfYear") << QDateTime(QDate(2019, 12, 31), last, Qt::UTC);
+    QTest::newRow("leapDay") << QDateTime(QDate(2020, 2, 29), last, Qt::UTC);
+}
+
+void BenchRadialClock::blips()
+{
+    QFETCH(QDateTime, instant);
+
+    RadialClock clock;
+    QBENCHMARK {
+        std::map<RadialClock::TimeCode, bool> blips;
+        clock.blips(instant, blips);
+    }
+}
+
+/************************************************************************
+** Hit testing every point along the diagonal of the face.
+************************************************************************/
+void BenchRadialClock::timeCodeAt()
+{
+    RadialClock clock;
+    QVERIFY(showClock(clock, QSize(256, 256)));
+    clock.repaint();
+
+    int hits = 0;
+    QBENCHMARK {
+        hits = 0;
+        for(int i = 0; i < 256; i++) {
+            if (clock.timeCodeAt(QPoint(i, i)) != RadialClock::InvalidTimeCode) {
+                hits++;
+            }
+        }
+    }
+    QVERIFY(hits > 0);
+}
+
+/************************************************************************
+** A click on a ring (which shows its description) or on the center.
+************************************************************************/
+void BenchRadialClock::mousePress_data()
+{
+    QTest::addColumn<bool>("ring");
+    QTest::newRow("miss") << false;
+    QTest::newRow("hit") << true;
+}
+
+void BenchRadialClock::mousePress()
+{
+    QFETCH(bool, ring);
+
+    RadialClock clock;
+    QVERIFY(showClock(clock, QSize(256, 256)));
+    clock.repaint();
+
+    // The outermost ring runs along the edge of the face.
+    QPoint pos = ring ? QPoint(128, 4) : QPoint(128, 128);
+    while(ring && clock.timeCodeAt(pos) == RadialClock::InvalidTimeCode && pos.y() < 128) {
+        pos.ry()++;
+    }
+    QCOMPARE(clock.timeCodeAt(pos) != RadialClock::InvalidTimeCode, ring);
+
+    QMouseEvent event(QEvent::MouseButtonPress, pos, clock.mapToGlobal(pos),
+                      Qt::LeftButton, Qt::LeftButton, Qt::NoModifier);
+    QBENCHMARK {
+        QCoreApplication::sendEvent(&clock, &event);
+    }
+}
+
+/************************************************************************
+** The rings of a 4K face filled as the clock does it, one annular sector
+** per ring, against the former way: a disc of the ring color, a disc of
+** the background over its inside and a background mask over the elapsed
+** part, touching every pixel of the face up to three times. The paths
+** are cached by the clock, so they are built outside of the loop.
+************************************************************************/
+void BenchRadialClock::ringFill_data()
+{
+    QTest::addColumn<QString>("method");
+    QTest::newRow("sector") << QString("sector");
+    QTest::newRow("overdraw") << QString("overdraw");
+}
+
+void BenchRadialClock::ringFill()
+{
+    QFETCH(QString, method);
+
+    int x = c4K.width()/2;
+    int y = c4K.height()/2;
+    std::vector<QPainterPath> sectors(cRingCount);
+    std::vector<QPainterPath> masks(cRingCount);
+    std::vector<QBrush> brushes(cRingCount);
+    for(int i = 0; i < cRingCount; i++) {
+        int r = ringRadius(i);
+        RadialClock::sectorPath(sectors[i], x, y, r, cRingThick, cRingAngles[i]);
+
+        qreal inner = r - cRingSpace/2.0;
+        qreal outer = r + cRingThick + cRingSpace/2.0;
+        QRectF innerBox(x-inner, y-inner, 2*inner, 2*inner);
+        QRectF outerBox(x-outer, y-outer, 2*outer, 2*outer);
+        masks[i].arcMoveTo(outerBox, 90);
+        masks[i].arcTo(outerBox, 90, -cRingAngles[i]);
+        masks[i].arcTo(innerBox, 90-cRingAngles[i], cRingAngles[i]);
+        masks[i].closeSubpath();
+
+        brushes[i] = QBrush(ringColor(i));
+    }
+
+    QImage image(c4K, QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::white);
+    QPainter painter(&image);
+    painter.setRenderHint(QPainter::Antialiasing);
+    painter.setPen(Qt::NoPen);
+    QBrush background(Qt::white);
+
+    if (method == "sector") {
+        QBENCHMARK {
+            for(int i = 0; i < cRingCount; i++) {
+                painter.fillPath(sectors[i], brushes[i]);
+            }
+        }
+    } else {
+        QBENCHMARK {
+            for(int i = 0; i < cRingCount; i++) {
+                int r = ringRadius(i);
+                painter.setBrush(brushes[i]);
+                painter.drawEllipse(QPoint(x, y), r + cRingThick, r + cRingThick);
+                painter.setBrush(background);
+                painter.drawEllipse(QPoint(x, y), r, r);
+                painter.fillPath(masks[i], background);
+            }
+        }
+    }
+}
+
+/************************************************************************
+** The rings of a 4K face through RingRasterizer with each instruction
+** set, against QPainter filling the same sector paths.
+************************************************************************/
+void BenchRadialClock::rasterizer_data()
+{
+    QTest::addColumn<int>("backend");
+    QTest::newRow("fillPath") << -1;
+    QTest::newRow("scalar") << int(RingRasterizer::Scalar);
+    QTest::newRow("sse2") << int(RingRasterizer::SSE2);
+    QTest::newRow("avx2") << int(RingRasterizer::AVX2);
+}
+
+void BenchRadialClock::rasterizer()
+{
+    QFETCH(int, backend);
+
+    RingRasterizer::Backend best = RingRasterizer::bestBackend();
+    if (backend > best) {
+        QSKIP("the CPU does not support this instruction set");
+    }
+
+    QPointF center(c4K.width()/2, c4K.height()/2);
+    QImage image(c4K, QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::white);
+
+    if (backend < 0) {
+        std::vector<QPainterPath> sectors(cRingCount);
+        std::vector<QBrush> brushes(cRingCount);
+        for(int i = 0; i < cRingCount; i++) {
+            RadialClock::sectorPath(sectors[i], center.x(), center.y(), ringRadius(i), cRingThick, cRingAngles[i]);
+            brushes[i] = QBrush(ringColor(i));
+        }
+        QPainter painter(&image);
+        painter.setRenderHint(QPainter::Antialiasing);
+        QBENCHMARK {
+            for(int i = 0; i < cRingCount; i++) {
+                painter.fillPath(sectors[i], brushes[i]);
+            }
+        }
+        return;
+    }
+
+    RingRasterizer::setBackend(RingRasterizer::Backend(backend));
+    QBENCHMARK {
+        for(int i = 0; i < cRingCount; i++) {
+            int r = ringRadius(i);
+            RingRasterizer::fill(image, center, r, r + cRingThick, cRingAngles[i], ringColor(i));
+        }
+    }
+    RingRasterizer::setBackend(best);
+}
+
+/************************************************************************
+** The center text alone (every ring hidden) with the time stepping a
+** second per paint, from the static text of the clock against the former
+** drawText path.
+************************************************************************/
+void BenchRadialClock::centerText_data()
+{
+    QTest::addColumn<bool>("staticText");
+    QTest::newRow("staticText") << true;
+    QTest::newRow("drawText") << false;
+}
+
+void BenchRadialClock::centerText()
+{
+    QFETCH(bool, staticText);
+
+    FixedTimeSource *source = new FixedTimeSource(cInstant);
+    RadialClock::setTimeSource(source);
+    RadialClock clock;
+    setRings(clock, "none");
+    DrawTextClock reference;
+    QWidget &widget = staticText ? static_cast<QWidget&>(clock) : reference;
+    QVERIFY(showClock(widget, QSize(200, 200)));
+    widget.repaint();
+
+    QDateTime now = cInstant;
+    QBENCHMARK {
+        now = now.addSecs(1);
+        source->setTime(now);
+        RadialClock::refreshTime();
+        widget.repaint();
+    }
+    RadialClock::setTimeSource(new FixedTimeSource(cInstant));
+}
+
+/************************************************************************
+** Moving a snapshot into a zone, through a QDateTime at the zone offset
+** or straight from the instant and the offset.
+************************************************************************/
+void BenchRadialClock::zonedSnapshot_data()
+{
+    QTest::addColumn<bool>("dateTime");
+    QTest::newRow("dateTime") << true;
+    QTest::newRow("offset") << false;
+}
+
+void BenchRadialClock::zonedSnapshot()
+{
+    QFETCH(bool, dateTime);
+
+    const ZoneTable *zone = ZoneTable::find("Europe/Berlin");
+    QVERIFY(zone != NULL);
+    RadialClock::TimeSnapshot snapshot;
+    qint64 msecs = cInstant.toMSecsSinceEpoch();
+    QBENCHMARK {
+        msecs += 1000;
+        if (dateTime) {
+            snapshot.update(zone->toLocal(msecs));
+        } else {
+            snapshot.update(msecs, zone->offsetAt(msecs));
+        }
+    }
+}
+
+/************************************************************************
+** A thousand small clocks in six zones, all shown, ticked one second
+** further on each iteration.
+************************************************************************/
+void BenchRadialClock::zonedClocks()
+{
+    FixedTimeSource *source = new FixedTimeSource(cInstant);
+    RadialClock::setTimeSource(source);
+
+    const int count = 1000;
+    const int side = 40;
+    const int columns = 32;
+    QWidget window;
+    std::vector<RadialClock*> clocks;
+    for(int i = 0; i < count; i++) {
+        RadialClock *clock = new RadialClock(&window);
+        clock->setTimeZone(cZones[i % cZoneCount]);
+        clock->setGeometry((i % columns)*side, (i / columns)*side, side, side);
+        clocks.push_back(clock);
+    }
+    QVERIFY(showClock(window, QSize(columns*side, (count + columns - 1)/columns*side)));
+    for(std::vector<RadialClock*>::const_iterator it(clocks.begin());
+        it != clocks.end(); it++) {
+        QVERIFY((*it)->paused() == false);
+    }
+
+    QDateTime now = cInstant;
+    QBENCHMARK {
+        now = now.addSecs(1);
+        source->setTime(now);
+        RadialClock::refreshTime();
+    }
+    RadialClock::setTimeSource(new FixedTimeSource(cInstant));
+}
+
+/************************************************************************
+** A year of simulated time, one frame per hour, each taken inside the
+** blip window of the last second of the hour so the blip decisions of
+** every ring are made and drawn. Live, a FixedTimeSource steps the shown
+** clock through the ticker and every step is repainted; headless, each
+** step is rendered with renderAt.
+************************************************************************/
+void BenchRadialClock::simulatedYear_data()
+{
+    QTest::addColumn<bool>("live");
+    QTest::newRow("live") << true;
+    QTest::newRow("headless") << false;
+}
+
+void BenchRadialClock::simulatedYear()
+{
+    QFETCH(bool, live);
+
+    QSize size(128, 128);
+    QDateTime start(QDate(2019, 1, 1), QTime(0, 59, 59, 900), Qt::UTC);
+    QDateTime end = start.addYears(1);
+    FixedTimeSource *source = new FixedTimeSource(start);
+    RadialClock::setTimeSource(source);
+    RadialClock clock;
+    clock.setBlip(true);
+    if (live) {
+        QVERIFY(showClock(clock, size));
+    }
+
+    int frames = 0;
+    QBENCHMARK {
+        frames = 0;
+        for(QDateTime t = start; t < end; t = t.addSecs(3600)) {
+            if (live) {
+                source->setTime(t);
+                RadialClock::refreshTime();
+                clock.repaint();
+            } else {
+                clock.renderAt(t, size);
+            }
+            frames++;
+        }
+    }
+    QCOMPARE(frames, 365*24);
+    RadialClock::setTimeSource(new FixedTimeSource(cInstant));
+}
+
+/************************************************************************
+** The cost of the frame that shows each kind of rollover, live (the time
+** source stepping across the boundary and back, a repaint after each
+** step) and headless.
+************************************************************************/
+void BenchRadialClock::rollover_data()
+{
+    QTest::addColumn<QDateTime>("instant");
+    QTest::addColumn<bool>("live");
+
+    struct Boundary {
+        const char *name;
+        QDateTime instant;
+    };
+    const Boundary boundaries[] = {
+        { "minute", QDateTime(QDate(2019, 6, 15), QTime(10, 21), Qt::UTC) },
+        { "hour", QDateTime(QDate(2019, 6, 15), QTime(11, 0), Qt::UTC) },
+        { "day", QDateTime(QDate(2019, 6, 16), QTime(0, 0), Qt::UTC) },
+        { "week", QDateTime(QDate(2019, 6, 17), QTime(0, 0), Qt::UTC) },
+        { "month", QDateTime(QDate(2019, 7, 1), QTime(0, 0), Qt::UTC) },
+        { "year", QDateTime(QDate(2020, 1, 1), QTime(0, 0), Qt::UTC) },
+        { "leapDay", QDateTime(QDate(2020, 3, 1), QTime(0, 0), Qt::UTC) },
+    };
+    for(int i = 0; i < 7; i++) {
+        QTest::newRow(qPrintable(QString("%1/live").arg(boundaries[i].name))) << boundaries[i].instant << true;
+        QTest::newRow(qPrintable(QString("%1/headless").arg(boundaries[i].name))) << boundaries[i].instant << false;
+    }
+}
+
+void BenchRadialClock::rollover()
+{
+    QFETCH(QDateTime, instant);
+    QFETCH(bool, live);
+
+    QSize size(256, 256);
+    RadialClock clock;
+    if (live == false) {
+        QBENCHMARK {
+            clock.renderAt(instant, size);
+        }
+        return;
+    }
+
+    QDateTime before = instant.addMSecs(-100);
+    FixedTimeSource *source = new FixedTimeSource(before);
+    RadialClock::setTimeSource(source);
+    QVERIFY(showClock(clock, size));
+    clock.repaint();
+
+    bool after = false;
+    QBENCHMARK {
+        after = !after;
+        source->setTime(after ? instant : before);
+        RadialClock::refreshTime();
+        clock.repaint();
+    }
+    RadialClock::setTimeSource(new FixedTimeSource(cInstant));
+}
+
+int main(int argc, char *argv[])
+{
+    // The benchmarks run without a display unless told otherwise.
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    QApplication app(argc, argv);
+    BenchRadialClock bench;
+    return QTest::qExec(&bench, argc, argv);
+}
+
+#include "bench_radial_clock.moc"
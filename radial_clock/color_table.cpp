@@ -0,0 +1,111 @@
+/****************************************************************************
+**
+** Copyright (C) 2018 Brian Hill
+** All rights reserved.
+**
+** License Agreement
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** Software Author: Brian Hill <brian.hill@glowfish.ca>
+**
+** Summary: Shared ring color tables of the radial clocks
+**
+****************************************************************************/
+
+#include "color_table.h"
+
+#include <map>
+#include <utility>
+
+namespace {
+    // The rainbow spread over every stage count, from red on the inside to
+    // violet on the outside; row S-1 holds the colors for S stages. Computed
+    // from the seven reference colors (red, orange, yellow, green, blue,
+    // indigo, violet) with the same interpolation as the gradients.
+    constexpr QRgb cRainbow[ColorTable::cMaxStages][ColorTable::cMaxStages] =
+    { { 0xffff0000 },
+      { 0xffff0000, 0xff9400d3 },
+      { 0xffff0000, 0xff00ff00, 0xff9400d3 },
+      { 0xffff0000, 0xffffff00, 0xff0000ff, 0xff9400d3 },
+      { 0xffff0000, 0xffffbf00, 0xff00ff00, 0xff2600c1, 0xff9400d3 },
+      { 0xffff0000, 0xffff9900, 0xff99ff00, 0xff006699, 0xff3c009b, 0xff9400d3 },
+      { 0xffff0000, 0xffff7f00, 0xffffff00, 0xff00ff00, 0xff0000ff, 0xff4b0082, 0xff9400d3 } };
+
+    typedef std::pair<QRgb, QRgb> gradientKey;
+    typedef std::map<gradientKey, std::weak_ptr<const ColorTable> > gradientMap;
+
+    gradientMap s_gradients;
+
+    int mix(int a, int b, double factor)
+    {
+        return int(a + factor * (b - a) + 0.5);
+    }
+}
+
+std::shared_ptr<const ColorTable> ColorTable::rainbow()
+{
+    static std::shared_ptr<const ColorTable> s_rainbow;
+    if (!s_rainbow) {
+        ColorTable *table = new ColorTable;
+        for(int s = 1; s <= cMaxStages; s++)
+        {
+            for(int i = 0; i < cMaxStages; i++)
+            {
+                table->m_colors[s][i] = cRainbow[s-1][i];
+            }
+        }
+        table->m_colors[0].fill(0);
+        s_rainbow.reset(table);
+    }
+    return s_rainbow;
+}
+
+std::shared_ptr<const ColorTable> ColorTable::gradient(const QColor &inner, const QColor &outer)
+{
+    gradientKey key(inner.rgba(), outer.rgba());
+    gradientMap::iterator it = s_gradients.find(key);
+    if (it != s_gradients.end()) {
+        std::shared_ptr<const ColorTable> shared = it->second.lock();
+        if (shared) {
+            return shared;
+        }
+    }
+
+    // Each stage count spreads its rings evenly from INNER to OUTER, a single
+    // ring takes INNER. The alpha of INNER is kept throughout.
+    ColorTable *table = new ColorTable;
+    table->m_colors[0].fill(0);
+    for(int s = 1; s <= cMaxStages; s++)
+    {
+        for(int i = 0; i < cMaxStages; i++)
+        {
+            double f = (s > 1 && i < s) ? (i + 0.0)/(s-1) : 0.0;
+            table->m_colors[s][i] = qRgba(mix(inner.red(), outer.red(), f),
+                                          mix(inner.green(), outer.green(), f),
+                                          mix(inner.blue(), outer.blue(), f),
+                                          inner.alpha());
+        }
+    }
+
+    // Drop the tables no clock uses any more before adding this one.
+    for(it = s_gradients.begin(); it != s_gradients.end(); ) {
+        if (it->second.expired()) {
+            it = s_gradients.erase(it);
+        } else {
+            it++;
+        }
+    }
+
+    std::shared_ptr<const ColorTable> shared(table);
+    s_gradients[key] = shared;
+    return shared;
+}
@@ -0,0 +1,63 @@
+/****************************************************************************
+**
+** Copyright (C) 2018 Brian Hill
+** All rights reserved.
+**
+** License Agreement
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** Software Author: Brian Hill <brian.hill@glowfish.ca>
+**
+** Summary: Header for the shared ring color tables of the radial clocks
+**
+****************************************************************************/
+
+#ifndef COLOR_TABLE_H
+#define COLOR_TABLE_H
+
+#include <QColor>
+#include <array>
+#include <memory>
+
+class ColorTable
+{
+public:
+    /************************************************************************
+    ** The most rings colored from one table.
+    ************************************************************************/
+    static const int cMaxStages = 7;
+
+    /************************************************************************
+    ** The shared tables. The rainbow one is built from a table computed
+    ** ahead of time, a gradient one is built on first use of its two end
+    ** colors and shared while any clock still holds it.
+    ************************************************************************/
+    static std::shared_ptr<const ColorTable> rainbow();
+    static std::shared_ptr<const ColorTable> gradient(const QColor &inner, const QColor &outer);
+
+    /************************************************************************
+    ** The color of ring I (from the innermost) when STAGES rings are shown.
+    ************************************************************************/
+    QRgb color(int stages, int i) const { return m_colors[stages][i]; }
+
+private:
+    ColorTable() {}
+
+    typedef std::array<std::array<QRgb, cMaxStages>, cMaxStages + 1> stageArray;
+
+    /************************************************************************
+    ** Internal Variables.
+    ************************************************************************/
+    stageArray m_colors;
+};
+
+#endif // COLOR_TABLE_H
@@ -22,12 +22,21 @@
 ****************************************************************************/
 
 #include "radial_clock.h"
+#include "ticker.h"
+#include "zone_table.h"
+#include "color_table.h"
+#include "ring_rasterizer.h"
 
 #include <QPainter>
-#include <QTimer>
 #include <QDateTime>
 #include <QMouseEvent>
 #include <QToolTip>
+#include <QPainterPath>
+#include <QElapsedTimer>
+#include <QScreen>
+#include <QGuiApplication>
+#include <QFontDatabase>
+#include <QtConcurrent/QtConcurrentMap>
 #include <math.h>
 
 #include <iostream>
@@ -54,12 +63,77 @@ const QString RadialClock::cTimeCodes[InvalidTimeCode] =
 const QColor RadialClock::cBlack = QColor(Qt::black);
 
 namespace {
+    // The pen of the center text, shared so that setting it on every paint
+    // does not allocate a new one.
+    const QPen cTextPen(Qt::black);
+
+    // The millisecond within a second after which the blip is shown.
+    const int cBlipStart = 800;
+
+    // Per TimeCode metadata.
+    // - related -- The smaller TimeCode whose rollover leads into this one.
+    // - limit -- The number of values, or 0 when it depends on the date.
+    // - blipOffset -- How far below the limit the last value before a rollover is.
+    // - day -- Whether the TimeCode counts days.
+    // - period -- The time one value lasts, in seconds (a month taken as 30 days).
+    struct TimeCodeInfo {
+        RadialClock::TimeCode related;
+        int limit;
+        int blipOffset;
+        bool day;
+        int period;
+    };
+
+    constexpr TimeCodeInfo cTimeCodeInfo[RadialClock::InvalidTimeCode] =
+      // related                       limit  blipOffset  day     period         TimeCode
+    { { RadialClock::InvalidTimeCode, 60,    1,          false,  1 },          // SecondOfMinute
+      { RadialClock::SecondOfMinute,  60,    1,          false,  60 },         // MinuteOfHour
+      { RadialClock::MinuteOfHour,    24,    1,          false,  3600 },       // HourOfDay
+      { RadialClock::HourOfDay,       7,     0,          true,   86400 },      // DayOfWeek
+      { RadialClock::HourOfDay,       0,     0,          true,   86400 },      // DayOfMonth
+      { RadialClock::HourOfDay,       0,     0,          true,   86400 },      // DayOfYear
+      { RadialClock::DayOfMonth,      12,    0,          false,  2592000 } };  // MonthOfYear
+
     QString boolToStr(bool v)
     {
         return v ? "true" : "false";
     }
+
+    // The format of the date shown in the center of the face.
+    const QString cDateFormat = "ddd d, MMM";
+
+    // The smooth mode moves the rings in steps of this many pixels along
+    // their outside edge.
+    const qreal cSmoothStep = 0.25;
+
+    // The display refresh assumed when the screen does not report one.
+    const qreal cDefaultRefresh = 60;
+
+    // The share of a frame interval a paint may take before the smooth
+    // mode slows down.
+    const qreal cPaintBudget = 0.5;
+
+    // The length of a day, and the Julian day of the epoch.
+    const qint64 cMsecsPerDay = 86400000;
+    const qint64 cEpochJulianDay = 2440588;
+
+    // The glyph of the time delimiter follows the ten digits.
+    const int cDelimiterGlyph = 10;
 }
 
+/************************************************************************
+** TickHook - Joins the clock to the Ticker, keeping the tick and the
+** schedule private to the clock.
+************************************************************************/
+struct RadialClock::TickHook : public TickClient {
+    explicit TickHook(RadialClock *c) : clock(c) {}
+
+    void tick(const TimeSnapshot &snapshot) { clock->tick(snapshot); }
+    int dueIn(const TimeSnapshot &snapshot) const { return clock->dueIn(snapshot); }
+
+    RadialClock *clock;
+};
+
 /************************************************************************
 ** Constructor/Destructor
 ************************************************************************/
@@ -73,19 +147,53 @@ RadialClock::RadialClock(QWidget *parent) :
     m_monthDays(true),
     m_yearDays(true),
     m_months(true),
-    m_rainbow(false)
+    m_rainbow(false),
+    m_hover(false),
+    m_hovered(-1),
+    m_softwareRaster(false),
+    m_colorsValid(false),
+    m_ringCount(0),
+    m_layerValid(false),
+    m_digitWidth(0),
+    m_lineHeight(0),
+    m_paused(true),
+    m_wakeupsSaved(0),
+    m_tickHook(new TickHook(this)),
+    m_zone(NULL),
+    m_smooth(false),
+    m_paintCost(0)
 {
-    m_timer = new QTimer(this);
-    connect(m_timer, SIGNAL(timeout()), this, SLOT(update()));
-    m_timer->start(250);
-
     m_outer_color.setRed(255);
     m_inner_color.setBlue(255);
+    m_palette = ColorTable::gradient(m_inner_color, m_outer_color);
+
+    // The clock joins the ticker once it is shown, see showEvent().
 }
 
 RadialClock::~RadialClock()
 {
-    delete m_timer;
+    Ticker::instance()->detach(m_tickHook.get());
+}
+
+void RadialClock::setTimeZone(const QString &z)
+{
+    m_timeZone = z;
+    m_zone = z.isEmpty() ? NULL : ZoneTable::find(z.toUtf8());
+
+    // Start over from the shared reading so the date fields are rebuilt.
+    m_snapshot = TimeSnapshot();
+    if (m_paused == false) {
+        tick(Ticker::instance()->snapshot());
+        reschedule();
+    }
+}
+
+void RadialClock::setHover(bool h)
+{
+    m_hover = h;
+    m_hovered = -1;
+    setMouseTracking(h);
+    update();
 }
 
 QString RadialClock::describe() const
@@ -100,6 +208,12 @@ QString RadialClock::describe() const
     props += "yearDays: " + boolToStr(yearDays()) + "\n";
     props += "months: " + boolToStr(months()) + "\n";
     props += "rainbow: " + boolToStr(rainbow()) + "\n";
+    props += "hover: " + boolToStr(hover()) + "\n";
+    props += "softwareRaster: " + boolToStr(softwareRaster()) + "\n";
+    props += "timeZone: " + timeZone() + "\n";
+    props += "smooth: " + boolToStr(smooth()) + "\n";
+    props += "paused: " + boolToStr(paused()) + "\n";
+    props += "wakeupsSaved: " + QString::number(wakeupsSaved()) + "\n";
     props += "outerColor: " + outerColor().name() + "\n";
     props += "innerColor: " + innerColor().name() + "\n";
     return props;
@@ -110,14 +224,7 @@ QString RadialClock::describe() const
 ************************************************************************/
 bool RadialClock::isDay(const TimeCode &tc)
 {
-    switch(tc) {
-        case DayOfWeek:
-        case DayOfMonth:
-        case DayOfYear:
-            return true;
-        default:
-            return false;
-    }
+    return (tc < InvalidTimeCode) ? cTimeCodeInfo[tc].day : false;
 }
 
 void RadialClock::related(const TimeCode &tc, std::vector<TimeCode> &family)
@@ -138,31 +245,7 @@ void RadialClock::related(const TimeCode &tc, std::vector<TimeCode> &family)
 
 RadialClock::TimeCode RadialClock::relatedTo(const TimeCode &tc)
 {
-    switch(tc) {
-        case SecondOfMinute:
-            return InvalidTimeCode;
-            break;
-        case MinuteOfHour:
-            return SecondOfMinute;
-            break;
-        case HourOfDay:
-            return MinuteOfHour;
-            break;
-        case DayOfWeek:
-            return HourOfDay;
-            break;
-        case DayOfMonth:
-            return HourOfDay;
-            break;
-        case DayOfYear:
-            return HourOfDay;
-            break;
-        case MonthOfYear:
-            return DayOfMonth;
-            break;
-        default:
-            return InvalidTimeCode;
-    }
+    return (tc < InvalidTimeCode) ? cTimeCodeInfo[tc].related : InvalidTimeCode;
 }
 
 int RadialClock::stages() const
@@ -240,58 +323,143 @@ int RadialClock::value(const QDateTime& dtime, const TimeCode &tc)
 int RadialClock::limit(const QDateTime& dtime, const TimeCode &tc)
 {
     switch(tc) {
-        case SecondOfMinute:
-            return 60;
-            break;
-        case MinuteOfHour:
-            return 60;
-            break;
-        case HourOfDay:
-            return 24;
-            break;
-        case DayOfWeek:
-            return 7;
-            break;
         case DayOfMonth:
             return dtime.date().daysInMonth();
             break;
         case DayOfYear:
             return dtime.date().daysInYear();
             break;
-        case MonthOfYear:
-            return 12;
+        case InvalidTimeCode:
+            return 0;
             break;
         default:
-            return 0;
+            return cTimeCodeInfo[tc].limit;
             break;
     }
 }
 
 int RadialClock::blipLimit(const QDateTime& dtime, const TimeCode &tc)
 {
-    switch(tc) {
-        case SecondOfMinute:
-        case MinuteOfHour:
-        case HourOfDay:
-            return limit(dtime, tc) - 1;
-            break;
-        default:
-            return limit(dtime, tc);
-            break;
-    }
+    return limit(dtime, tc) - ((tc < InvalidTimeCode) ? cTimeCodeInfo[tc].blipOffset : 0);
 }
 
 void RadialClock::blips(const QDateTime &dtime, std::map<TimeCode, bool> &blips) const
 {
-    const QTime &time = dtime.time();
-    bool showBlip = (blip() && time.msec() > 800);
-    blips.insert(std::make_pair(SecondOfMinute, showBlip));
-    ForEachTimeCode(currentTC)
+    TimeSnapshot snapshot;
+    snapshot.update(dtime);
+    ForEachTimeCode(tc)
+    {
+        blips.insert(std::make_pair(tc, showBlip(snapshot, tc)));
+    }
+}
+
+bool RadialClock::showBlip(const TimeSnapshot &snapshot, TimeCode tc) const
+{
+    return blip() && snapshot.blipping && snapshot.blips[tc];
+}
+
+int RadialClock::nextChange(const TimeSnapshot &snapshot) const
+{
+    // The center text shows the seconds, so the face changes at least on
+    // every second boundary.
+    int msec = snapshot.time.msec();
+    int wait = 1000 - msec;
+
+    // The smooth mode wakes every frame, landing on the second boundaries.
+    // Its countdowns sweep along with the frames, their deadlines only
+    // mark them for evaluation on the next tick.
+    if (smooth()) {
+        int interval = (m_frameStats.interval > 0) ? m_frameStats.interval : 1000/int(cDefaultRefresh);
+        return std::min(wait, interval);
+    }
+
+    // A countdown may move before the next second.
+    for(countdownVector::const_iterator it(m_countdowns.begin());
+        it != m_countdowns.end(); it++) {
+        if (it->due > snapshot.msecs) {
+            wait = int(std::min(qint64(wait), it->due - snapshot.msecs));
+        }
+    }
+
+    // Before the blip window opens, check whether any of the visible rings
+    // will actually blip during this second.
+    if (blip() && snapshot.blipping == false) {
+        ForEachTimeCode(tc)
+        {
+            if (display(tc) && snapshot.blips[tc]) {
+                return cBlipStart + 1 - msec;
+            }
+        }
+    }
+
+    return wait;
+}
+
+void RadialClock::TimeSnapshot::update(const QDateTime &dtime)
+{
+    update(dtime.toMSecsSinceEpoch(), dtime.date(), dtime.time());
+}
+
+void RadialClock::TimeSnapshot::update(qint64 instant, int offset)
+{
+    // The local time read as if it were UTC splits into whole days since
+    // the epoch and the time of day.
+    qint64 local = instant + qint64(offset)*1000;
+    qint64 day = local / cMsecsPerDay;
+    if (local % cMsecsPerDay < 0) {
+        day--;
+    }
+    int ms = int(local - day*cMsecsPerDay);
+    update(instant, QDate::fromJulianDay(cEpochJulianDay + day), QTime::fromMSecsSinceStartOfDay(ms));
+}
+
+void RadialClock::TimeSnapshot::update(qint64 instant, const QDate &d, const QTime &t)
+{
+    // Day level fields only change on a date rollover.
+    if (d != date) {
+        date = d;
+        values[DayOfWeek] = d.dayOfWeek();
+        values[DayOfMonth] = d.day();
+        values[DayOfYear] = d.dayOfYear();
+        values[MonthOfYear] = d.month();
+        limits[DayOfWeek] = cTimeCodeInfo[DayOfWeek].limit;
+        limits[DayOfMonth] = d.daysInMonth();
+        limits[DayOfYear] = d.daysInYear();
+        limits[MonthOfYear] = cTimeCodeInfo[MonthOfYear].limit;
+    }
+
+    msecs = instant;
+    time = t;
+    values[SecondOfMinute] = time.second();
+    values[MinuteOfHour] = time.minute();
+    values[HourOfDay] = time.hour();
+    limits[SecondOfMinute] = cTimeCodeInfo[SecondOfMinute].limit;
+    limits[MinuteOfHour] = cTimeCodeInfo[MinuteOfHour].limit;
+    limits[HourOfDay] = cTimeCodeInfo[HourOfDay].limit;
+
+    // A TimeCode blips when the one it relates to is blipping on its last value.
+    blipping = (time.msec() > cBlipStart);
+    blips[SecondOfMinute] = true;
+    for(int tc = MinuteOfHour; tc < InvalidTimeCode; tc++)
     {
-        TimeCode relatedTC = relatedTo(currentTC);
-        if (relatedTC == InvalidTimeCode) continue;
-        showBlip = (blips[relatedTC] && value(dtime, relatedTC) == (blipLimit(dtime, relatedTC)));
-        blips.insert(std::make_pair(currentTC, showBlip));
+        int r = cTimeCodeInfo[tc].related;
+        blips[tc] = blips[r] && values[r] == limits[r] - cTimeCodeInfo[r].blipOffset;
+    }
+
+    ForEachTimeCode(tc)
+    {
+        angles[tc] = int(values[tc]/(limits[tc]+0.0)*360);
+    }
+
+    // The part of the current value that has passed is how far its related
+    // TimeCode has come around. Counters that start at 1 have one value less
+    // elapsed than they show.
+    ForEachTimeCode(tc)
+    {
+        TimeCode r = cTimeCodeInfo[tc].related;
+        qreal part = (r == InvalidTimeCode) ? time.msec()/1000.0 : progress[r]/360;
+        int first = 1 - cTimeCodeInfo[tc].blipOffset;
+        progress[tc] = (values[tc] - first + part)/limits[tc]*360;
     }
 }
 
@@ -301,8 +469,7 @@ void RadialClock::blips(const QDateTime &dtime, std::map<TimeCode, bool> &blips)
 
 const QColor &RadialClock::getColor(TimeCode tc) const
 {
-    std::map<TimeCode, QColor>::const_iterator it = m_colors.find(tc);
-    return (it == m_colors.end()) ? cBlack : it->second;
+    return (tc < InvalidTimeCode) ? m_colors[tc] : cBlack;
 }
 
 QColor interpolateColor(const QColor &a, const QColor &b, double factor)
@@ -336,173 +503,838 @@ void RadialClock::getColors(const std::vector<QColor> &reference, int s, std::ve
 
 void RadialClock::processColors()
 {
-    if (m_colors.empty() == false) return;
-    std::vector<QColor> reference;
-    if (rainbow()) {
-        reference.push_back(QColor(255,0,0));    // Red
-        reference.push_back(QColor(255,127,0));  // Orange
-        reference.push_back(QColor(255,255,0));  // Yellow
-        reference.push_back(QColor(0,255,0));    // Green
-        reference.push_back(QColor(0,0,255));    // Blue
-        reference.push_back(QColor(75,0,130));   // Indogo
-        reference.push_back(QColor(148,0,211));  // Violet
-    } else {
-        reference.push_back(innerColor());
-        reference.push_back(outerColor());
-    }
+    if (m_colorsValid) return;
 
-    std::vector<QColor> colors;
-    getColors(reference, stages(), colors);
+    // The visible rings take the colors for their count from the shared
+    // table, the hidden ones fall back to black.
+    int s = stages();
     int index = 0;
     ForEachTimeCode(tc)
     {
-        if (display(tc) == false) {
-            continue;
-        }
-        m_colors.insert(std::make_pair(tc, colors[index++]));
+        m_colors[tc] = display(tc) ? QColor::fromRgba(m_palette->color(s, index++)) : cBlack;
     }
+    m_colorsValid = true;
+}
+
+void RadialClock::updatePalette()
+{
+    m_palette = rainbow() ? ColorTable::rainbow() : ColorTable::gradient(innerColor(), outerColor());
+    m_colorsValid = false;
+    invalidateLayer();
 }
 
 void RadialClock::paintEvent(QPaintEvent *)
 {
+    QElapsedTimer timer;
+    timer.start();
+
     processColors();
-    QDateTime dtime = QDateTime::currentDateTime();
-    QDate date = dtime.date();
-    QTime time = dtime.time();
-    QString delim = ((time.second()) % 2 == 0) ? ":" : " ";
-    QString pattern = "hh"+delim+"mm"+delim+"ss";
+    const TimeSnapshot &snapshot = m_snapshot;
 
-    QString date_text = date.toString("ddd d, MMM");
-    QString time_text = time.toString(pattern);
+    QPainter painter(this);
+    painter.setRenderHint(QPainter::Antialiasing);
 
-    int W = width();
-    int H = height();
-    int S = std::min(W, H);
-    int cx = W/2;
-    int cy = H/2;
+    m_ringCount = collectRings(snapshot, m_rings);
 
-    QPainter painter(this);
+    bool relayout = (m_layerValid == false || m_layer.size() != size()*devicePixelRatioF());
+    if (relayout) {
+        m_geometry = layout(size(), m_ringCount);
+    }
+    if (smooth()) {
+        snapRings(m_rings, m_ringCount, m_geometry);
+    }
+    if (relayout || layerStale()) {
+        paintLayer();
+    }
+    painter.drawPixmap(0, 0, m_layer);
+    paintRings(painter);
+    paintHover(painter);
+    paintText(painter, snapshot);
+    painter.end();
+
+    // Keep the statistics, and let the smooth mode back off from paints
+    // that outgrow their share of the frame.
+    qreal cost = timer.nsecsElapsed()/1000000.0;
+    FrameStats &stats = m_frameStats;
+    stats.averageMsecs += (cost - stats.averageMsecs)/(stats.frames + 1);
+    stats.worstMsecs = std::max(stats.worstMsecs, cost);
+    stats.frames++;
+    if (smooth()) {
+        if (stats.interval > 0 && cost > stats.interval) {
+            stats.overBudget++;
+        }
+        m_paintCost += (cost - m_paintCost)/8;
+        updatePacing();
+    }
+}
+
+int RadialClock::ringAt(const QPoint &pos) const
+{
+    const Geometry &g = m_geometry;
+    if (m_layerValid == false || g.count == 0) {
+        return -1;
+    }
+
+    int dx = pos.x() - g.x;
+    int dy = pos.y() - g.y;
+    int d = int(sqrt(double(dx*dx + dy*dy))) - g.base;
+    if (d < 0) {
+        return -1;
+    }
+
+    // The rings are evenly spaced, so the ring index follows directly from
+    // the distance; anything beyond the ring thickness falls in the spacing.
+    int pitch = g.thick + g.space;
+    int i = d / pitch;
+    if (i >= g.count || d - i*pitch > g.thick) {
+        return -1;
+    }
+    return i;
+}
+
+RadialClock::TimeCode RadialClock::timeCodeAt(const QPoint &pos) const
+{
+    int i = ringAt(pos);
+    return (i >= 0) ? m_rings[i].tc : InvalidTimeCode;
+}
+
+void RadialClock::mousePressEvent(QMouseEvent *event)
+{
+    int i = ringAt(event->pos());
+    if (i < 0) {
+        return;
+    }
+
+    QToolTip::showText(event->globalPos(), ringLabel(m_rings[i]));
+}
+
+void RadialClock::mouseMoveEvent(QMouseEvent *event)
+{
+    if (hover() == false) {
+        return;
+    }
+
+    // Nothing to do while the pointer stays over the same ring.
+    int i = ringAt(event->pos());
+    if (i == m_hovered) {
+        return;
+    }
+
+    m_hovered = i;
+    if (i < 0) {
+        QToolTip::hideText();
+    } else {
+        QToolTip::showText(event->globalPos(), ringLabel(m_rings[i]), this);
+    }
+    update();
+}
+
+void RadialClock::leaveEvent(QEvent *)
+{
+    if (m_hovered < 0) {
+        return;
+    }
+
+    m_hovered = -1;
+    update();
+}
+
+void RadialClock::tick(const TimeSnapshot &snapshot)
+{
+    // A zoned clock moves the shared reading into its own zone, only the
+    // offset is looked up so this stays cheap for many clocks.
+    TimeSnapshot next = snapshot;
+    if (m_zone != NULL) {
+        next = m_snapshot;
+        next.update(snapshot.msecs, m_zone->offsetAt(snapshot.msecs));
+    }
+
+    bool dateChanged = (next.date != m_snapshot.date);
+    bool textChanged = (dateChanged || next.time.second() != m_snapshot.time.second());
+    m_snapshot = next;
+    evaluateCountdowns(m_snapshot.msecs);
+
+    const Geometry &g = m_geometry;
+    ringArray rings;
+    int count = collectRings(m_snapshot, rings);
+    if (m_layerValid == false || count != m_ringCount || count != g.count) {
+        update();
+        return;
+    }
+    if (smooth()) {
+        snapRings(rings, count, g);
+    }
+
+    // The rings are nested, so the square around the outermost ring that
+    // moved since the last paint covers every ring inside it too.
+    int changed = -1;
+    for(int i = 0; i < count; i++)
+    {
+        if (rings[i].angle != m_rings[i].angle) {
+            changed = i;
+        }
+    }
+
+    QRegion dirty;
+    if (changed >= 0) {
+        int R = g.radius(changed) + g.thick + 1;
+        dirty += QRect(g.x - R, g.y - R, 2*R, 2*R);
+    }
+    if (textChanged) {
+        dirty += m_textRect;
+    }
+    if (dateChanged) {
+        // The new date may be wider than the one last painted, lay it out
+        // now (once a day) to cover where it will be drawn too.
+        updateText(m_snapshot);
+        dirty += textRect();
+    }
+    if (dirty.isEmpty() == false) {
+        update(dirty);
+    }
+}
+
+int RadialClock::dueIn(const TimeSnapshot &snapshot) const
+{
+    return nextChange((m_zone != NULL) ? m_snapshot : snapshot);
+}
+
+const TimeSource *RadialClock::timeSource()
+{
+    return Ticker::instance()->timeSource();
+}
+
+void RadialClock::setTimeSource(TimeSource *source)
+{
+    Ticker::instance()->setTimeSource(source);
+}
+
+void RadialClock::refreshTime()
+{
+    Ticker::instance()->refresh();
+}
+
+void RadialClock::reschedule()
+{
+    Ticker::instance()->reschedule(m_tickHook.get());
+    emit settingsChanged();
+}
+
+void RadialClock::resizeEvent(QResizeEvent *)
+{
+    invalidateLayer();
+}
+
+void RadialClock::showEvent(QShowEvent *)
+{
+    // Watch the window for being covered or uncovered, it may have been
+    // recreated since the last show.
+    QWindow *handle = window()->windowHandle();
+    if (handle != m_exposeWindow) {
+        if (m_exposeWindow) {
+            m_exposeWindow->removeEventFilter(this);
+        }
+        m_exposeWindow = handle;
+        if (handle != NULL) {
+            handle->installEventFilter(this);
+        }
+    }
+    updateActivity();
+}
+
+void RadialClock::hideEvent(QHideEvent *)
+{
+    // Minimizing sends a hide while the widget still counts as visible.
+    setPaused(true);
+}
+
+bool RadialClock::eventFilter(QObject *watched, QEvent *event)
+{
+    if (watched == m_exposeWindow && event->type() == QEvent::Expose) {
+        updateActivity();
+    }
+    return QWidget::eventFilter(watched, event);
+}
+
+void RadialClock::updateActivity()
+{
+    bool exposed = (m_exposeWindow == NULL) || m_exposeWindow->isExposed();
+    setPaused(isVisible() == false || exposed == false);
+}
+
+void RadialClock::setPaused(bool p)
+{
+    if (p == m_paused) {
+        return;
+    }
+    m_paused = p;
+
+    if (p) {
+        Ticker::instance()->detach(m_tickHook.get());
+        m_pausedTimer.start();
+        return;
+    }
+
+    // Attaching hands over the current time, so the clock catches up in
+    // one paint rather than replaying the missed ticks.
+    if (m_pausedTimer.isValid()) {
+        m_wakeupsSaved += m_pausedTimer.elapsed()/1000 * (blip() ? 2 : 1);
+    }
+    Ticker::instance()->attach(m_tickHook.get());
+}
+
+// Renders one frame of a range, run from the worker threads.
+struct RadialClock::FrameRenderer {
+    typedef QImage result_type;
+
+    const RadialClock *clock;
+    QSize size;
+    QColor background;
+    QFont font;
+
+    QImage operator()(const QDateTime &dtime) const
+    {
+        return clock->frame(dtime, size, background, font);
+    }
+};
+
+QImage RadialClock::renderAt(const QDateTime &dtime, const QSize &size)
+{
+    processColors();
+    return frame(dtime, size, palette().color(backgroundRole()), font());
+}
+
+QVector<QImage> RadialClock::renderRange(const QDateTime &from, const QDateTime &to, int step, const QSize &size)
+{
+    QVector<QDateTime> times;
+    if (step <= 0) {
+        return QVector<QImage>();
+    }
+    for(QDateTime t = from; t <= to; t = t.addMSecs(step)) {
+        times.push_back(t);
+    }
+
+    // The colors, palette and font are shared by every frame, settle them
+    // here before fanning out since the widget itself is not thread safe.
+    processColors();
+    FrameRenderer renderer = { this, size, palette().color(backgroundRole()), font() };
+    if (QFontDatabase::supportsThreadedFontRendering() == false) {
+        QVector<QImage> frames;
+        for(QVector<QDateTime>::const_iterator it(times.begin());
+            it != times.end(); it++) {
+            frames.push_back(renderer(*it));
+        }
+        return frames;
+    }
+    return QtConcurrent::blockingMapped<QVector<QImage> >(times, renderer);
+}
+
+QImage RadialClock::frame(const QDateTime &dtime, const QSize &size, const QColor &background, const QFont &font) const
+{
+    TimeSnapshot snapshot;
+    if (m_zone != NULL) {
+        qint64 msecs = dtime.toMSecsSinceEpoch();
+        snapshot.update(msecs, m_zone->offsetAt(msecs));
+    } else {
+        snapshot.update(dtime);
+    }
+
+    QImage image(size, QImage::Format_ARGB32_Premultiplied);
+    render(image, snapshot, background, font);
+    return image;
+}
+
+void RadialClock::render(QImage &image, const TimeSnapshot &snapshot, const QColor &background, const QFont &font) const
+{
+    // Only the arguments and the settled colors are read, so frames can be
+    // rendered from several threads at once.
+    ringArray rings;
+    int count = collectRings(snapshot, rings);
+    Geometry g = layout(image.size(), count);
+    image.fill(background);
+
+    if (softwareRaster()) {
+        for(int i = 0; i < count; i++)
+        {
+            int r = g.radius(i);
+            RingRasterizer::fill(image, QPointF(g.x, g.y), r, r + g.thick, rings[i].angle, ringColor(rings[i]));
+        }
+    }
+
+    QPainter painter(&image);
     painter.setRenderHint(QPainter::Antialiasing);
+    if (softwareRaster() == false) {
+        for(int i = 0; i < count; i++)
+        {
+            if (rings[i].angle >= 360) {
+                continue;
+            }
+            QPainterPath path;
+            sectorPath(path, g.x, g.y, g.radius(i), g.thick, rings[i].angle);
+            painter.fillPath(path, ringColor(rings[i]));
+        }
+    }
 
-    std::map<TimeCode, bool> useBlips;
-    blips(dtime, useBlips);
+    QString delim = ((snapshot.time.second()) % 2 == 0) ? ":" : " ";
+    QString pattern = "hh"+delim+"mm"+delim+"ss";
+    int S = std::min(image.width(), image.height());
+    QRectF textBorder(g.x-S/2, g.y-S/2, S, S);
+    painter.setFont(font);
+    painter.setPen(cBlack);
+    painter.drawText(textBorder, Qt::AlignCenter,
+                     snapshot.date.toString(cDateFormat) + QString("\n") + snapshot.time.toString(pattern));
+}
+
+RadialClock::Geometry RadialClock::layout(const QSize &size, int count)
+{
+    Geometry g;
+    int S = std::min(size.width(), size.height());
+    g.x = size.width()/2;
+    g.y = size.height()/2;
+    g.count = count;
+    g.base = S/100 * 20;
+    g.space = std::max(1, S/100);
+    g.thick = (count > 0) ? std::max(1, (S/2 - g.base - (count-1)*g.space)/count) : 0;
+    return g;
+}
+
+void RadialClock::addAngle(ringArray &rings, int &count, TimeCode tc, qreal angle, bool blip)
+{
+    if (blip && angle > 2) angle -= 2;
+    Ring &ring = rings[count++];
+    ring.tc = tc;
+    ring.countdown = -1;
+    ring.angle = angle;
+}
 
-    angleVector angles;
+int RadialClock::collectRings(const TimeSnapshot &snapshot, ringArray &rings) const
+{
+    int count = 0;
     ForEachTimeCode(tc)
     {
         if (display(tc) == false) {
             continue;
         }
-        addAngle(angles, tc, value(dtime, tc), limit(dtime, tc), useBlips[tc]);
+        if (smooth()) {
+            addAngle(rings, count, tc, snapshot.progress[tc]);
+        } else {
+            addAngle(rings, count, tc, snapshot.angles[tc], showBlip(snapshot, tc));
+        }
     }
 
-    int N = angles.size();
-    int base = S/100 * 20;
-    int space = std::max(1, S/100);
-    int thick = (S/2 - base - (N-1)*space)/N;
+    // The countdowns go around the outside, their cached angle is used
+    // while it still holds for the instant.
+    for(int i = 0; i < countdowns(); i++)
+    {
+        const CountdownState &state = m_countdowns[i];
+        Ring &ring = rings[count++];
+        ring.tc = InvalidTimeCode;
+        ring.countdown = i;
+        if (snapshot.msecs >= state.from && snapshot.msecs < state.due) {
+            ring.angle = state.angle;
+        } else {
+            ring.angle = countdownAngle(state.ring, snapshot.msecs, NULL);
+        }
+    }
+    return count;
+}
+
+qreal RadialClock::countdownAngle(const Countdown &countdown, qint64 msecs, qint64 *due) const
+{
+    qint64 period = std::max(qint64(1), countdown.period);
+    qint64 left = countdown.remaining ? countdown.remaining(msecs) : 0;
+    left = std::min(period, std::max(qint64(0), left));
+    qint64 elapsed = period - left;
+    qreal angle = elapsed*360.0/period;
 
-    paintRings(painter, cx, cy, thick, space, base, angles);
+    // The smooth mode sweeps, so the angle only holds for this instant.
+    if (smooth()) {
+        if (due != NULL) {
+            *due = msecs + 1;
+        }
+        return angle;
+    }
 
-    QRectF textBorder(cx-S/2, cy-S/2, S, S);
-    painter.setPen(cBlack);
-    painter.drawText(textBorder, Qt::AlignCenter, date_text + QString("\n") + time_text );
+    // The ring steps a whole degree at a time, it next moves once the
+    // elapsed time reaches the following degree. A finished countdown is
+    // checked again every second for its next cycle.
+    int degrees = int(angle);
+    if (due != NULL) {
+        qint64 next = (qint64(degrees + 1)*period + 359)/360;
+        *due = (left > 0) ? msecs + std::max(qint64(1), next - elapsed) : msecs + 1000;
+    }
+    return degrees;
 }
 
-void RadialClock::mousePressEvent(QMouseEvent *event)
+void RadialClock::evaluateCountdowns(qint64 msecs)
 {
-    if (m_regions.empty()) {
-       return;
-    }
-    int W = width();
-    int H = height();
-    int cx = W/2;
-    int cy = H/2;
-    int dx = abs(cx - event->x());
-    int dy = abs(cy - event->y());
-    int dist = int(sqrt(pow(dx,2) + pow(dy,2)));
-    std::map<int, TimeCode>::const_iterator it = m_regions.lower_bound(dist);
-    // If inside the smallest ring.
-    if (it == m_regions.begin()) {
-        if (it->second > dist) {
-            return;
+    // Only the countdowns whose angle may have moved are asked again.
+    for(countdownVector::iterator it(m_countdowns.begin());
+        it != m_countdowns.end(); it++) {
+        if (msecs >= it->from && msecs < it->due) {
+            continue;
         }
-    } else if (it->second != dist) {
-        it--;
+        it->from = msecs;
+        it->angle = countdownAngle(it->ring, msecs, &it->due);
     }
+}
 
-    // Convert to time code.
-    if (it->first > dist) {
-        return;
+const QColor &RadialClock::ringColor(const Ring &ring) const
+{
+    return (ring.countdown >= 0) ? m_countdowns[ring.countdown].ring.color : getColor(ring.tc);
+}
+
+QString RadialClock::ringLabel(const Ring &ring) const
+{
+    return (ring.countdown >= 0) ? m_countdowns[ring.countdown].ring.label : cTimeCodes[ring.tc];
+}
+
+int RadialClock::addCountdown(const Countdown &countdown)
+{
+    if (countdowns() >= cMaxCountdowns) {
+        return -1;
     }
 
-    TimeCode tc = it->second;
-    it++;
-    if (it == m_regions.end()) {
-        return;
+    CountdownState state = { countdown, 0, 0, 0 };
+    m_countdowns.push_back(state);
+    invalidateLayer();
+    reschedule();
+    return countdowns() - 1;
+}
+
+void RadialClock::setCountdown(int index, const Countdown &countdown)
+{
+    CountdownState &state = m_countdowns[index];
+    state.ring = countdown;
+    state.from = 0;
+    state.due = 0;
+    invalidateLayer();
+    reschedule();
+}
+
+void RadialClock::removeCountdown(int index)
+{
+    m_countdowns.erase(m_countdowns.begin() + index);
+    m_hovered = -1;
+    invalidateLayer();
+    reschedule();
+}
+
+void RadialClock::snapRings(ringArray &rings, int count, const Geometry &g)
+{
+    for(int i = 0; i < count; i++)
+    {
+        qreal R = g.radius(i) + g.thick;
+        if (R <= 0) {
+            continue;
+        }
+        qreal step = cSmoothStep/R * 180/M_PI;
+        rings[i].angle = floor(rings[i].angle/step)*step;
     }
+}
 
-    if (it->second != tc) {
-        return;
+void RadialClock::updatePacing()
+{
+    // No faster than the display refreshes.
+    QWindow *handle = window()->windowHandle();
+    QScreen *screen = (handle != NULL) ? handle->screen() : QGuiApplication::primaryScreen();
+    qreal refresh = (screen != NULL && screen->refreshRate() > 0) ? screen->refreshRate() : cDefaultRefresh;
+    qreal interval = 1000/refresh;
+
+    // No faster than the innermost ring moves a step, small faces move
+    // too slowly to show every frame.
+    // A countdown ring goes around once per period.
+    const Geometry &g = m_geometry;
+    if (g.count > 0) {
+        const Ring &ring = m_rings[0];
+        qreal cycle = 0;
+        if (ring.tc < InvalidTimeCode) {
+            cycle = 1000.0 * cTimeCodeInfo[ring.tc].period * m_snapshot.limits[ring.tc];
+        } else if (ring.countdown >= 0 && ring.countdown < countdowns()) {
+            cycle = std::max(qint64(1), m_countdowns[ring.countdown].ring.period);
+        }
+        if (cycle > 0) {
+            qreal R = g.radius(0) + g.thick;
+            interval = std::max(interval, cSmoothStep / (2*M_PI*R / cycle));
+        }
     }
 
-    QToolTip::showText(event->globalPos(), cTimeCodes[tc]);
+    // No faster than the paints can keep up within their budget.
+    interval = std::max(interval, m_paintCost/cPaintBudget);
+    m_frameStats.interval = std::max(1, std::min(1000, int(ceil(interval))));
 }
 
-void RadialClock::addAngle(angleVector &angles, TimeCode tc, int value, int ref, bool blip)
+void RadialClock::resetFrameStats()
 {
-    int angle = int(value/(ref+0.0)*360);
-    if (blip && angle > 2) angle -= 2;
-    angles.push_back(std::make_pair(tc, angle));
+    int interval = m_frameStats.interval;
+    m_frameStats = FrameStats();
+    m_frameStats.interval = interval;
 }
 
-void RadialClock::paintRing(QPainter &painter, const QColor &clr, int x, int y, int r, int t, int a)
+void RadialClock::updateGlyphs(const QFont &font)
 {
-    const QBrush &brush = painter.background();
-    const QPen &pen = painter.pen();
+    if (m_glyphs[0].text().isEmpty() || font != m_textFont) {
+        m_textFont = font;
+        m_textDate = QDate();
 
-    // Draw the outer ring
-    int xp = x - r - t;
-    int yp = y - r - t;
-    int w = 2*(r+t);
-    painter.setPen(clr);
-    painter.setBrush(clr);
-    painter.drawEllipse(xp, yp, w, w);
+        QFontMetricsF metrics(m_textFont);
+        m_digitWidth = 0;
+        m_lineHeight = metrics.lineSpacing();
+        for(int i = 0; i < cDelimiterGlyph; i++)
+        {
+            QChar digit('0' + i);
+#if QT_VERSION >= QT_VERSION_CHECK(5,11,0)
+            m_digitWidth = std::max(m_digitWidth, metrics.horizontalAdvance(digit));
+#else
+            m_digitWidth = std::max(m_digitWidth, metrics.width(digit));
+#endif
+            m_glyphs[i] = QStaticText(QString(digit));
+        }
+        m_glyphs[cDelimiterGlyph] = QStaticText(QString(":"));
+        for(int i = 0; i <= cDelimiterGlyph; i++)
+        {
+            m_glyphs[i].setTextFormat(Qt::PlainText);
+            m_glyphs[i].setPerformanceHint(QStaticText::AggressiveCaching);
+            m_glyphs[i].prepare(QTransform(), m_textFont);
+        }
+    }
+}
 
-    // Draw the inner ring
-    xp = x - r;
-    yp = y - r;
-    w = 2*r;
-    painter.setPen(brush.color());
-    painter.setBrush(brush);
-    painter.drawEllipse(xp, yp, w, w);
+void RadialClock::updateText(const TimeSnapshot &snapshot)
+{
+    updateGlyphs(font());
 
-    // Draw the mask shape
-    if (a > 0) {
-        w = 2*(r + t) + 2;
-        QRectF border(x-r-t-1, y-r-t-1, w, w);
-        painter.drawPie(border, 90*16, -a*16);
+    // The date part is only laid out when the day changes.
+    if (snapshot.date != m_textDate) {
+        m_textDate = snapshot.date;
+        prepareDate(m_dateText, snapshot.date, m_textFont);
     }
+}
 
-    painter.setPen(pen);
+void RadialClock::prepareDate(QStaticText &text, const QDate &date, const QFont &font)
+{
+    text = QStaticText(date.toString(cDateFormat));
+    text.setTextFormat(Qt::PlainText);
+    text.prepare(QTransform(), font);
+}
+
+qreal RadialClock::timeWidth() const
+{
+    return 6*m_digitWidth + 2*m_glyphs[cDelimiterGlyph].size().width();
+}
+
+QRect RadialClock::textRect() const
+{
+    // Two centered lines as laid out, the wider one sets the width.
+    qreal textWidth = std::max(timeWidth(), m_dateText.size().width());
+    qreal top = height()/2 - m_lineHeight;
+    return QRectF(width()/2 - textWidth/2, top, textWidth, 2*m_lineHeight)
+           .toAlignedRect().adjusted(-1, -1, 1, 1);
+}
+
+void RadialClock::paintTime(QPainter &painter, const QTime &time, QPointF pos) const
+{
+    // The digits sit in fixed cells so the time does not wobble as it changes.
+    int digits[6] = { time.hour()/10, time.hour()%10,
+                      time.minute()/10, time.minute()%10,
+                      time.second()/10, time.second()%10 };
+    bool delim = (time.second() % 2 == 0);
+    qreal delimWidth = m_glyphs[cDelimiterGlyph].size().width();
+    for(int i = 0; i < 6; i++)
+    {
+        const QStaticText &glyph = m_glyphs[digits[i]];
+        painter.drawStaticText(pos + QPointF((m_digitWidth - glyph.size().width())/2, 0), glyph);
+        pos.rx() += m_digitWidth;
+        if (i == 1 || i == 3) {
+            if (delim) {
+                painter.drawStaticText(pos, m_glyphs[cDelimiterGlyph]);
+            }
+            pos.rx() += delimWidth;
+        }
+    }
+}
+
+void RadialClock::paintText(QPainter &painter, const TimeSnapshot &snapshot)
+{
+    updateText(snapshot);
+    m_textRect = textRect();
+
+    // Two centered lines, the date above the time.
+    qreal dateWidth = m_dateText.size().width();
+    qreal top = height()/2 - m_lineHeight;
+    painter.setPen(cTextPen);
+    painter.setFont(m_textFont);
+    painter.drawStaticText(QPointF(width()/2 - dateWidth/2, top), m_dateText);
+    paintTime(painter, snapshot.time, QPointF(width()/2 - timeWidth()/2, top + m_lineHeight));
+}
+
+void RadialClock::invalidateLayer()
+{
+    m_layerValid = false;
+    emit settingsChanged();
+}
+
+bool RadialClock::layerStale() const
+{
+    for(int i = 1; i < m_ringCount; i++)
+    {
+        if (m_rings[i].angle != m_layerAngles[i]) {
+            return true;
+        }
+    }
+    return false;
 }
 
-void RadialClock::paintRings(QPainter &painter, int x, int y, int thick, int space, int base, const angleVector &angles)
+void RadialClock::paintLayer()
 {
-    const QBrush &brush = painter.background();
-    const QPen &pen = painter.pen();
-    m_regions.clear();
+    const Geometry &g = m_geometry;
+    qreal ratio = devicePixelRatioF();
+
+    if (softwareRaster()) {
+        QImage image(size()*ratio, QImage::Format_ARGB32_Premultiplied);
+        image.fill(Qt::transparent);
+        for(int i = 1; i < g.count; i++)
+        {
+            rasterizeRing(image, QPointF(g.x*ratio, g.y*ratio), ratio, i);
+            m_layerAngles[i] = m_rings[i].angle;
+        }
+        m_layer = QPixmap::fromImage(image);
+        m_layer.setDevicePixelRatio(ratio);
+        m_layerValid = true;
+        return;
+    }
 
-    int N = angles.size();
-    int R = (N-1)*thick + (N-1)*space + base;
-    for(angleVector::const_reverse_iterator it(angles.rbegin());
-        it != angles.rend(); it++)
+    if (m_layer.size() != size()*ratio) {
+        m_layer = QPixmap(size()*ratio);
+        m_layer.setDevicePixelRatio(ratio);
+    }
+    m_layer.fill(Qt::transparent);
+
+    QPainter painter(&m_layer);
+    painter.setRenderHint(QPainter::Antialiasing);
+
+    for(int i = 1; i < g.count; i++)
     {
-        m_regions.insert(std::make_pair(R, it->first));
-        m_regions.insert(std::make_pair(R+thick, it->first));
-        paintRing(painter, getColor(it->first), x, y, R, thick, it->second);
-        R -= thick + space;
+        const Ring &ring = m_rings[i];
+        paintSector(painter, m_sectors[i], ringColor(ring), g.x, g.y, g.radius(i), g.thick, ring.angle);
+        m_layerAngles[i] = ring.angle;
+    }
+
+    m_layerValid = true;
+}
+
+void RadialClock::sectorPath(QPainterPath &path, int x, int y, int r, int t, qreal a)
+{
+    QRectF innerBox(x-r, y-r, 2*r, 2*r);
+    QRectF outerBox(x-r-t, y-r-t, 2*(r+t), 2*(r+t));
+
+    // The remaining part runs clockwise from the elapsed angle back up
+    // to the top, along the outside and then back along the inside.
+    path.arcMoveTo(outerBox, 90-a);
+    path.arcTo(outerBox, 90-a, -(360-a));
+    path.arcTo(innerBox, 90-360, 360-a);
+    path.closeSubpath();
+}
+
+void RadialClock::paintSector(QPainter &painter, Sector &sector, const QColor &clr, int x, int y, int r, int t, qreal a)
+{
+    // The whole ring has elapsed.
+    if (a >= 360) {
+        return;
+    }
+
+    if (sector.x != x || sector.y != y || sector.r != r || sector.t != t) {
+        sector.x = x;
+        sector.y = y;
+        sector.r = r;
+        sector.t = t;
+        sector.a = -1;
+        sector.paths.clear();
+    }
+    if (sector.brush.style() == Qt::NoBrush || sector.brush.color() != clr) {
+        sector.brush = QBrush(clr);
+    }
+
+    if (smooth()) {
+        if (sector.a != a) {
+            sector.a = a;
+#if QT_VERSION >= QT_VERSION_CHECK(5,13,0)
+            sector.path.clear();
+#else
+            sector.path = QPainterPath();
+#endif
+            sectorPath(sector.path, x, y, r, t, a);
+        }
+        painter.fillPath(sector.path, sector.brush);
+        return;
+    }
+
+    // The angles are below 2^9 degrees, keyed in steps of 2^-20 degrees.
+    quint32 key = quint32(qRound(a * 1048576));
+    QPainterPath *path = sector.paths.object(key);
+    if (path == NULL) {
+        path = new QPainterPath;
+        sectorPath(*path, x, y, r, t, a);
+        sector.paths.insert(key, path);
+    }
+    painter.fillPath(*path, sector.brush);
+}
+
+void RadialClock::paintRings(QPainter &painter)
+{
+    // The outer rings come from the layer, only the innermost is live.
+    const Geometry &g = m_geometry;
+    if (g.count == 0) {
+        return;
+    }
+
+    if (softwareRaster()) {
+        // Rasterize into a scratch image around the ring, aligned to the
+        // device pixels so that it is blitted without resampling.
+        qreal ratio = devicePixelRatioF();
+        int half = int(ceil((g.radius(0) + g.thick)*ratio)) + 2;
+        int side = 2*half;
+        if (m_scratch.width() != side || m_scratch.devicePixelRatio() != ratio) {
+            m_scratch = QImage(side, side, QImage::Format_ARGB32_Premultiplied);
+            m_scratch.setDevicePixelRatio(ratio);
+        }
+        m_scratch.fill(Qt::transparent);
+
+        qreal cx = g.x*ratio;
+        qreal cy = g.y*ratio;
+        int left = int(floor(cx)) - half;
+        int top = int(floor(cy)) - half;
+        rasterizeRing(m_scratch, QPointF(cx - left, cy - top), ratio, 0);
+        painter.drawImage(QPointF(left/ratio, top/ratio), m_scratch);
+        return;
+    }
+
+    const Ring &ring = m_rings[0];
+    paintSector(painter, m_sectors[0], ringColor(ring), g.x, g.y, g.radius(0), g.thick, ring.angle);
+}
+
+void RadialClock::rasterizeRing(QImage &image, const QPointF &center, qreal ratio, int i)
+{
+    const Geometry &g = m_geometry;
+    const Ring &ring = m_rings[i];
+    qreal r = g.radius(i)*ratio;
+    RingRasterizer::fill(image, center, r, r + g.thick*ratio, ring.angle, ringColor(ring));
+}
+
+void RadialClock::paintHover(QPainter &painter)
+{
+    const Geometry &g = m_geometry;
+    if (m_hovered < 0 || m_hovered >= g.count) {
+        return;
     }
 
-    painter.setBrush(brush);
+    // Outline the track of the hovered ring.
+    int r = g.radius(m_hovered);
+    int t = g.thick;
+    QPen pen(ringColor(m_rings[m_hovered]).darker(150));
+    pen.setWidth(std::max(1, g.space));
     painter.setPen(pen);
+    painter.setBrush(Qt::NoBrush);
+    painter.drawEllipse(QPoint(g.x, g.y), r, r);
+    painter.drawEllipse(QPoint(g.x, g.y), r + t, r + t);
 }
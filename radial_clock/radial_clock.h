@@ -26,12 +26,33 @@
 
 #include <QWidget>
 #include <QToolTip>
+#include <QPixmap>
+#include <QImage>
+#include <QVector>
+#include <QDateTime>
+#include <QPainterPath>
+#include <QBrush>
+#include <QCache>
+#include <QStaticText>
+#include <QElapsedTimer>
+#include <QPointer>
+#include <QWindow>
 #include <map>
+#include <array>
+#include <vector>
+#include <functional>
+#include <memory>
 #include <QtDesigner/QDesignerExportWidget>
 
+class TimeSource;
+class RadialClockWall;
+class ZoneTable;
+class ColorTable;
+
 class QDESIGNER_WIDGET_EXPORT RadialClock : public QWidget
 {
     Q_OBJECT
+    friend class RadialClockWall;
     Q_PROPERTY(bool blip READ blip WRITE setBlip);
     Q_PROPERTY(bool seconds READ seconds WRITE setSeconds);
     Q_PROPERTY(bool minutes READ minutes WRITE setMinutes);
@@ -43,6 +64,10 @@ class QDESIGNER_WIDGET_EXPORT RadialClock : public QWidget
     Q_PROPERTY(QColor outerColor READ outerColor WRITE setOuterColor);
     Q_PROPERTY(QColor innerColor READ innerColor WRITE setInnerColor);
     Q_PROPERTY(bool rainbow READ rainbow WRITE setRainbow);
+    Q_PROPERTY(bool hover READ hover WRITE setHover);
+    Q_PROPERTY(bool softwareRaster READ softwareRaster WRITE setSoftwareRaster);
+    Q_PROPERTY(QString timeZone READ timeZone WRITE setTimeZone);
+    Q_PROPERTY(bool smooth READ smooth WRITE setSmooth);
 
 public:
     explicit RadialClock(QWidget *parent = 0);
@@ -62,41 +87,110 @@ public:
     ** - outerColor -- The color of the outer ring
     ** Note: all in-between rings will be colored on a gradient between INNER and OUTER
     ** - rainbow -- An override to color the rings based on the colors of the rainbow
+    ** - hover -- Whether to highlight and describe the ring under the pointer
+    ** - softwareRaster -- Whether to rasterize the rings with RingRasterizer
+    **   instead of filling paths with QPainter
+    ** - timeZone -- The IANA id of the zone to show the time in, empty (or
+    **   unknown) for local time
+    ** - smooth -- Whether the rings sweep continuously, including the
+    **   progress of their smaller units, instead of stepping (no blip)
     ************************************************************************/
     bool blip() const { return m_blip; }
-    void setBlip(bool b) { m_blip = b; }
+    void setBlip(bool b) { m_blip = b;
+                           reschedule(); }
 
     bool seconds() const { return m_seconds; }
-    void setSeconds(bool s) { m_seconds = s; }
+    void setSeconds(bool s) { m_seconds = s;
+                              m_colorsValid = false;
+                              invalidateLayer(); }
 
     bool minutes() const { return m_minutes; }
-    void setMinutes(bool m) { m_minutes = m; }
+    void setMinutes(bool m) { m_minutes = m;
+                              m_colorsValid = false;
+                              invalidateLayer(); }
 
     bool hours() const { return m_hours; }
-    void setHours(bool h) { m_hours = h; }
+    void setHours(bool h) { m_hours = h;
+                            m_colorsValid = false;
+                            invalidateLayer(); }
 
     bool weekDays() const { return m_weekDays; }
-    void setWeekDays(bool d) { m_weekDays = d; }
+    void setWeekDays(bool d) { m_weekDays = d;
+                               m_colorsValid = false;
+                               invalidateLayer(); }
 
     bool monthDays() const { return m_monthDays; }
-    void setMonthDays(bool d) { m_monthDays = d; }
+    void setMonthDays(bool d) { m_monthDays = d;
+                                m_colorsValid = false;
+                                invalidateLayer(); }
 
     bool yearDays() const { return m_yearDays; }
-    void setYearDays(bool d) { m_yearDays = d; }
+    void setYearDays(bool d) { m_yearDays = d;
+                               m_colorsValid = false;
+                               invalidateLayer(); }
 
     bool months() const { return m_months; }
-    void setMonths(bool m) { m_months = m; }
+    void setMonths(bool m) { m_months = m;
+                             m_colorsValid = false;
+                             invalidateLayer(); }
 
     QColor outerColor() const { return m_outer_color; }
     void setOuterColor(const QColor &c) { m_outer_color = c;
-                                          m_colors.clear(); }
+                                          updatePalette(); }
 
     QColor innerColor() const { return m_inner_color; }
     void setInnerColor(const QColor &c) { m_inner_color = c;
-                                          m_colors.clear(); }
+                                          updatePalette(); }
 
     bool rainbow() const { return m_rainbow; }
-    void setRainbow(bool r) { m_rainbow = r; }
+    void setRainbow(bool r) { m_rainbow = r;
+                              updatePalette(); }
+
+    bool hover() const { return m_hover; }
+    void setHover(bool h);
+
+    bool softwareRaster() const { return m_softwareRaster; }
+    void setSoftwareRaster(bool s) { m_softwareRaster = s;
+                                     invalidateLayer(); }
+
+    QString timeZone() const { return m_timeZone; }
+    void setTimeZone(const QString &z);
+
+    bool smooth() const { return m_smooth; }
+    void setSmooth(bool s) { m_smooth = s;
+                             invalidateLayer();
+                             reschedule(); }
+
+    /************************************************************************
+    ** Activity
+    ** - paused -- Whether the clock has stopped ticking as it is hidden,
+    **   minimized or not exposed (Read-Only).
+    ** - wakeupsSaved -- An estimate of the ticks skipped while paused
+    **   (Read-Only).
+    ************************************************************************/
+    bool paused() const { return m_paused; }
+    long wakeupsSaved() const { return m_wakeupsSaved; }
+
+    /************************************************************************
+    ** FrameStats - The cost of the paints since the last reset.
+    ** - frames -- The number of paints.
+    ** - overBudget -- The paints that took longer than the frame interval.
+    ** - averageMsecs -- The mean time of a paint.
+    ** - worstMsecs -- The longest time of a paint.
+    ** - interval -- The current frame interval of the smooth mode (in ms).
+    ************************************************************************/
+    struct FrameStats {
+        FrameStats() : frames(0), overBudget(0), averageMsecs(0), worstMsecs(0), interval(0) {}
+
+        long frames;
+        long overBudget;
+        qreal averageMsecs;
+        qreal worstMsecs;
+        int interval;
+    };
+
+    const FrameStats &frameStats() const { return m_frameStats; }
+    void resetFrameStats();
 
     QString describe() const;
 
@@ -116,6 +210,40 @@ public:
     };
     static const QString cTimeCodes[InvalidTimeCode];
 
+    /************************************************************************
+    ** TimeSnapshot - The state of every TimeCode at one instant, computed
+    ** once per tick and shared by all the clocks.
+    ** - values -- The current value of each TimeCode.
+    ** - limits -- The number of values of each TimeCode.
+    ** - blips -- Whether each TimeCode blips in the blip window of this second.
+    ** - angles -- The elapsed angle (in degrees) of each TimeCode.
+    ** - progress -- The elapsed angle of each TimeCode including the progress
+    **   through its smaller units, for the smooth mode.
+    ** - blipping -- Whether this instant is inside the blip window.
+    ** - msecs -- The instant, in milliseconds since the epoch.
+    ** - update -- Move to an instant, either as a date and time or as
+    **   milliseconds since the epoch shown at an offset from UTC (in
+    **   seconds), which does not build a QDateTime.
+    ** Note: the day level fields are only recomputed when the date changes.
+    ************************************************************************/
+    struct TimeSnapshot {
+        QDate date;
+        QTime time;
+        int values[InvalidTimeCode];
+        int limits[InvalidTimeCode];
+        bool blips[InvalidTimeCode];
+        int angles[InvalidTimeCode];
+        qreal progress[InvalidTimeCode];
+        bool blipping;
+        qint64 msecs;
+
+        void update(const QDateTime &dtime);
+        void update(qint64 instant, int offset);
+
+    private:
+        void update(qint64 instant, const QDate &d, const QTime &t);
+    };
+
     static bool isDay(const TimeCode &tc);
     static void related(const TimeCode &tc, std::vector<TimeCode> &family);
     static TimeCode relatedTo(const TimeCode &tc);
@@ -125,6 +253,65 @@ public:
     static int limit(const QDateTime &dtime, const TimeCode &tc);
     static int blipLimit(const QDateTime &dtime, const TimeCode &tc);
     void blips(const QDateTime &dtime, std::map<TimeCode, bool> &blips) const;
+    bool showBlip(const TimeSnapshot &snapshot, TimeCode tc) const;
+    int nextChange(const TimeSnapshot &snapshot) const;
+    TimeCode timeCodeAt(const QPoint &pos) const;
+
+    /************************************************************************
+    ** Countdown - A custom ring counting down to a deadline, drawn outside
+    ** of the TimeCode rings in the order they were added.
+    ** - label -- The description shown for the ring.
+    ** - color -- The color of the ring.
+    ** - period -- The length of one cycle, in milliseconds.
+    ** - remaining -- The milliseconds left of the cycle at an instant (in
+    **   milliseconds since the epoch). It has to count down in step with the
+    **   time, and may only jump back up once it has reached 0.
+    ** Note: a countdown is only evaluated again once its ring can have moved,
+    ** so many of them cost little more per tick than the TimeCode rings.
+    ************************************************************************/
+    struct Countdown {
+        Countdown() : period(0) {}
+
+        QString label;
+        QColor color;
+        qint64 period;
+        std::function<qint64 (qint64 msecs)> remaining;
+    };
+
+    static const int cMaxCountdowns = 32;
+
+    int countdowns() const { return int(m_countdowns.size()); }
+    const Countdown &countdown(int index) const { return m_countdowns[index].ring; }
+    int addCountdown(const Countdown &countdown);
+    void setCountdown(int index, const Countdown &countdown);
+    void removeCountdown(int index);
+
+    /************************************************************************
+    ** Time Source - Where every clock reads the time from, the system clock
+    ** unless set. The clocks take ownership, NULL restores the system clock.
+    ** - refreshTime -- Read the source again right away, e.g. after a fixed
+    **   source is moved.
+    ************************************************************************/
+    static const TimeSource *timeSource();
+    static void setTimeSource(TimeSource *source);
+    static void refreshTime();
+
+    /************************************************************************
+    ** Headless Rendering
+    ** - renderAt -- Render the clock face for any instant into an image,
+    **   the widget does not need to be visible.
+    ** - renderRange -- Render the instants FROM, FROM+STEP, ... up to TO
+    **   (in milliseconds), spreading the frames over all the cores.
+    ************************************************************************/
+    QImage renderAt(const QDateTime &dtime, const QSize &size);
+    QVector<QImage> renderRange(const QDateTime &from, const QDateTime &to, int step, const QSize &size);
+
+    /************************************************************************
+    ** Ring Geometry
+    ** - sectorPath -- Add the remaining part of a ring around X, Y to PATH,
+    **   from the inner radius R and thickness T, with A degrees elapsed.
+    ************************************************************************/
+    static void sectorPath(QPainterPath &path, int x, int y, int r, int t, qreal a);
 
     /************************************************************************
     ** Color Processing.
@@ -132,6 +319,7 @@ public:
     static const QColor cBlack;
 
     void processColors();
+    void updatePalette();
     const QColor &getColor(TimeCode tc) const;
     void getColors(const std::vector<QColor> &reference, int s, std::vector<QColor> &colors);
 
@@ -141,14 +329,85 @@ protected:
     ************************************************************************/
     void paintEvent(QPaintEvent *);
     void mousePressEvent(QMouseEvent *);
+    void mouseMoveEvent(QMouseEvent *);
+    void leaveEvent(QEvent *);
+    void resizeEvent(QResizeEvent *);
+    void showEvent(QShowEvent *);
+    void hideEvent(QHideEvent *);
+    bool eventFilter(QObject *watched, QEvent *event);
 
 private:
-    typedef std::vector<std::pair<TimeCode, int> > angleVector;
+    struct TickHook;
+
+    /************************************************************************
+    ** Ring - A visible ring of the face and its elapsed angle. The rings of
+    ** a frame are kept in a fixed array, ordered from the innermost out.
+    ************************************************************************/
+    struct Ring {
+        TimeCode tc;
+        int countdown;
+        qreal angle;
+    };
+    static const int cMaxRings = InvalidTimeCode + cMaxCountdowns;
+    typedef std::array<Ring, cMaxRings> ringArray;
+
+    /************************************************************************
+    ** CountdownState - A countdown and its angle, which holds from the
+    ** instant FROM until the instant DUE (in milliseconds since the epoch).
+    ************************************************************************/
+    struct CountdownState {
+        Countdown ring;
+        qint64 from;
+        qint64 due;
+        qreal angle;
+    };
+    typedef std::vector<CountdownState> countdownVector;
+
+    /************************************************************************
+    ** Geometry - The ring layout for the current size and ring set, the
+    ** ring at index i (from the innermost) spans radius(i) to radius(i)+thick.
+    ************************************************************************/
+    struct Geometry {
+        int x;
+        int y;
+        int base;
+        int space;
+        int thick;
+        int count;
+
+        int radius(int i) const { return base + i*(thick + space); }
+    };
+
+    /************************************************************************
+    ** Sector - The annular sector paths covering the remaining part of one
+    ** ring, dropped when its radius or thickness changes, and its brush,
+    ** only rebuilt when the color changes. A stepping ring comes back to
+    ** the same few angles (at most twice its count of values, with the
+    ** blip), so a path is kept for each and a tick allocates nothing once
+    ** every step has been painted. A sweeping ring rarely repeats an angle,
+    ** so the smooth mode only keeps the last path and rebuilds it whenever
+    ** the ring moves, the innermost ring on almost every frame; the
+    ** software rasterizer needs no path at all.
+    ************************************************************************/
+    static const int cSectorPaths = 128;
+
+    struct Sector {
+        Sector() : x(0), y(0), r(0), t(0), a(-1), paths(cSectorPaths) {}
+
+        int x;
+        int y;
+        int r;
+        int t;
+        qreal a;
+        QPainterPath path;
+        QCache<quint32, QPainterPath> paths;
+        QBrush brush;
+    };
 
     /************************************************************************
     ** Internal Variables.
     ************************************************************************/
-    QTimer *m_timer;
+    TimeSnapshot m_snapshot;
     bool m_blip;
     bool m_seconds;
     bool m_minutes;
@@ -160,14 +419,110 @@ private:
     QColor m_outer_color;
     QColor m_inner_color;
     bool m_rainbow;
-    std::map<TimeCode, QColor> m_colors;
-    std::map<int, TimeCode> m_regions;
+    bool m_hover;
+    int m_hovered;
+    bool m_softwareRaster;
+    std::array<QColor, InvalidTimeCode> m_colors;
+    bool m_colorsValid;
+    std::shared_ptr<const ColorTable> m_palette;
+    ringArray m_rings;
+    int m_ringCount;
+    Geometry m_geometry;
+    std::array<Sector, cMaxRings> m_sectors;
+    QPixmap m_layer;
+    bool m_layerValid;
+    std::array<qreal, cMaxRings> m_layerAngles;
+    QImage m_scratch;
+    QDate m_textDate;
+    QFont m_textFont;
+    QStaticText m_dateText;
+    std::array<QStaticText, 11> m_glyphs;
+    qreal m_digitWidth;
+    qreal m_lineHeight;
+    QRect m_textRect;
+    bool m_paused;
+    long m_wakeupsSaved;
+    QElapsedTimer m_pausedTimer;
+    QPointer<QWindow> m_exposeWindow;
+    std::unique_ptr<TickHook> m_tickHook;
+    QString m_timeZone;
+    const ZoneTable *m_zone;
+    countdownVector m_countdowns;
+    bool m_smooth;
+    FrameStats m_frameStats;
+    qreal m_paintCost;
 
-    void addAngle(angleVector &angles, TimeCode tc, int value, int ref, bool blip = false);
-    void paintRing(QPainter &painter, const QColor &clr, int x, int y, int r, int t, int a);
-    void paintRings(QPainter &painter, int x, int y, int t, int s, int b, const angleVector &angles);
+    /************************************************************************
+    ** Layer Cache
+    ** All rings but the innermost one change rarely, they are rendered once
+    ** into the transparent m_layer and only redrawn when one of their angles,
+    ** the size, the colors or the ring set changes. Each frame blits the
+    ** layer and draws the innermost ring on top.
+    ************************************************************************/
+    void invalidateLayer();
+    bool layerStale() const;
+    void paintLayer();
+
+    static Geometry layout(const QSize &size, int count);
+    static void addAngle(ringArray &rings, int &count, TimeCode tc, qreal angle, bool blip = false);
+    int collectRings(const TimeSnapshot &snapshot, ringArray &rings) const;
+    qreal countdownAngle(const Countdown &countdown, qint64 msecs, qint64 *due) const;
+    void evaluateCountdowns(qint64 msecs);
+    const QColor &ringColor(const Ring &ring) const;
+    QString ringLabel(const Ring &ring) const;
+    int ringAt(const QPoint &pos) const;
+
+    /************************************************************************
+    ** Smooth Mode
+    ** The swept angles are snapped to steps of a fraction of a pixel along
+    ** the outside of each ring, so a ring only counts as changed (and the
+    ** layer is only redrawn) once the motion is visible. The frame interval
+    ** follows from the display refresh, the speed of the innermost ring at
+    ** the current size, and the measured cost of a paint.
+    ************************************************************************/
+    static void snapRings(ringArray &rings, int count, const Geometry &g);
+    void updatePacing();
+    /************************************************************************
+    ** Center Text
+    ** The date is laid out once per day. The time is drawn from laid out
+    ** glyphs for the digits and the delimiter, rebuilt when the font
+    ** changes, so no text is shaped on the tick.
+    ************************************************************************/
+    static void prepareDate(QStaticText &text, const QDate &date, const QFont &font);
+    void updateGlyphs(const QFont &font);
+    void updateText(const TimeSnapshot &snapshot);
+    qreal timeWidth() const;
+    QRect textRect() const;
+    void paintTime(QPainter &painter, const QTime &time, QPointF pos) const;
+    void paintText(QPainter &painter, const TimeSnapshot &snapshot);
+    struct FrameRenderer;
+    QImage frame(const QDateTime &dtime, const QSize &size, const QColor &background, const QFont &font) const;
+    void render(QImage &image, const TimeSnapshot &snapshot, const QColor &background, const QFont &font) const;
+    void paintSector(QPainter &painter, Sector &sector, const QColor &clr, int x, int y, int r, int t, qreal a);
+    void rasterizeRing(QImage &image, const QPointF &center, qreal ratio, int i);
+    void paintRings(QPainter &painter);
+    void paintHover(QPainter &painter);
+
+    /************************************************************************
+    ** Scheduling
+    ** All clocks are driven by the shared Ticker, which hands every clock
+    ** the same time reading once its next change is due. A tick only
+    ** invalidates what moved since the last paint: the square around the
+    ** outermost ring whose angle changed and the center text. The clock
+    ** joins the ticker through its TickHook (see Ticker).
+    ************************************************************************/
+    void tick(const TimeSnapshot &snapshot);
+    int dueIn(const TimeSnapshot &snapshot) const;
+    void reschedule();
+    void updateActivity();
+    void setPaused(bool p);
 
 signals:
+    /************************************************************************
+    ** - settingsChanged -- The rings, their colors, their layout or their
+    **   schedule may have changed.
+    ************************************************************************/
+    void settingsChanged();
 
 public slots:
 
@@ -0,0 +1,44 @@
+#-------------------------------------------------
+#
+# Copyright (C) 2018 Brian Hill
+# All rights reserved
+#
+# License Agreement
+#
+# This program is free software: you can distribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# any later version
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY of FITNESS FOR A PARTICULAR PURPOSE. See the
+# GNU General Public License for more details.
+#
+# Software Author: Brian Hill <brian.hill@glowfish.ca>
+#
+# The radial clock widgets, shared by the designer plugin and by the
+# benchmark and test executables, which build them in.
+#
+#-------------------------------------------------
+
+INCLUDEPATH += $$PWD
+DEPENDPATH += $$PWD
+
+DEFINES += QDESIGNER_EXPORT_WIDGETS
+
+SOURCES += $$PWD/radial_clock.cpp \
+    $$PWD/ticker.cpp \
+    $$PWD/time_source.cpp \
+    $$PWD/radial_clock_wall.cpp \
+    $$PWD/zone_table.cpp \
+    $$PWD/color_table.cpp \
+    $$PWD/ring_rasterizer.cpp
+
+HEADERS += $$PWD/radial_clock.h \
+    $$PWD/ticker.h \
+    $$PWD/time_source.h \
+    $$PWD/radial_clock_wall.h \
+    $$PWD/zone_table.h \
+    $$PWD/color_table.h \
+    $$PWD/ring_rasterizer.h
@@ -21,7 +21,7 @@
 #
 #-------------------------------------------------
 
-QT += widgets designer
+QT += widgets designer concurrent
 
 CONFIG += plugin release
 
@@ -31,11 +31,11 @@ target.path = $$[QT_INSTALL_PLUGINS]/designer
 INSTALLS += target
 TEMPLATE = lib
 
-SOURCES += radial_clock.cpp \
-    radial_clock_plugin.cpp
+include(radial_clock.pri)
 
-HEADERS  += radial_clock.h \
-    radial_clock_plugin.h
+SOURCES += radial_clock_plugin.cpp
+
+HEADERS  += radial_clock_plugin.h
 
 DISTFILES += \
     radial_clock.json
@@ -0,0 +1,317 @@
+/****************************************************************************
+**
+** Copyright (C) 2018 Brian Hill
+** All rights reserved.
+**
+** License Agreement
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** Software Author: Brian Hill <brian.hill@glowfish.ca>
+**
+** Summary: A wall of radial clocks painted by a single widget
+**
+****************************************************************************/
+
+#include "radial_clock_wall.h"
+#include "ticker.h"
+
+#include <QPainter>
+#include <QPaintEvent>
+#include <math.h>
+
+namespace {
+    // The most sprite pixels kept in the cache.
+    const int cSpriteBudget = 16*1024*1024;
+}
+
+/************************************************************************
+** Constructor/Destructor
+************************************************************************/
+RadialClockWall::RadialClockWall(QWidget *parent) :
+    QWidget(parent),
+    m_face(new RadialClock(this)),
+    m_columns(0),
+    m_geometry(),
+    m_sprites(cSpriteBudget),
+    m_ticking(false)
+{
+    m_face->hide();
+    connect(m_face, SIGNAL(settingsChanged()), this, SLOT(restyle()));
+}
+
+RadialClockWall::~RadialClockWall()
+{
+    setTicking(false);
+}
+
+void RadialClockWall::setColumns(int c)
+{
+    m_columns = std::max(0, c);
+    relayout();
+}
+
+int RadialClockWall::addClock(int offset)
+{
+    Cell cell;
+    cell.offset = offset;
+    m_cells.push_back(cell);
+    advance(m_cells.back(), Ticker::instance()->snapshot());
+    relayout();
+    return count() - 1;
+}
+
+int RadialClockWall::addClock(const QString &zone)
+{
+    int index = addClock(0);
+    setZone(index, zone);
+    return index;
+}
+
+void RadialClockWall::removeClock(int index)
+{
+    m_cells.erase(m_cells.begin() + index);
+    relayout();
+}
+
+void RadialClockWall::setOffset(int index, int offset)
+{
+    Cell &cell = m_cells[index];
+    cell.offset = offset;
+    advance(cell, Ticker::instance()->snapshot());
+    update(cellRect(index));
+}
+
+QString RadialClockWall::zone(int index) const
+{
+    const ZoneTable *table = m_cells[index].zone;
+    return (table != NULL) ? QString::fromUtf8(table->id()) : QString();
+}
+
+void RadialClockWall::setZone(int index, const QString &zone)
+{
+    Cell &cell = m_cells[index];
+    cell.zone = zone.isEmpty() ? NULL : ZoneTable::find(zone.toUtf8());
+    advance(cell, Ticker::instance()->snapshot());
+    update(cellRect(index));
+}
+
+int RadialClockWall::columnCount() const
+{
+    if (m_columns > 0) {
+        return m_columns;
+    }
+    return std::max(1, int(ceil(sqrt(double(count())))));
+}
+
+QRect RadialClockWall::cellRect(int index) const
+{
+    int c = columnCount();
+    return QRect(QPoint((index % c) * m_cellSize.width(), (index / c) * m_cellSize.height()),
+                 m_cellSize);
+}
+
+void RadialClockWall::relayout()
+{
+    int c = columnCount();
+    int r = std::max(1, (count() + c - 1) / c);
+    m_cellSize = QSize(width()/c, height()/r);
+    restyle();
+}
+
+void RadialClockWall::restyle()
+{
+    m_face->processColors();
+    m_geometry = RadialClock::layout(m_cellSize, m_face->stages() + m_face->countdowns());
+    m_sprites.clear();
+    for(cellVector::iterator it(m_cells.begin());
+        it != m_cells.end(); it++) {
+        it->count = m_face->collectRings(it->snapshot, it->rings);
+        if (m_face->smooth()) {
+            RadialClock::snapRings(it->rings, it->count, m_geometry);
+        }
+    }
+    update();
+
+    // The rings or the blip setting may have changed the schedule.
+    if (m_ticking) {
+        Ticker::instance()->reschedule(this);
+    }
+}
+
+void RadialClockWall::advance(Cell &cell, const RadialClock::TimeSnapshot &snapshot)
+{
+    int offset = (cell.zone != NULL) ? cell.zone->offsetAt(snapshot.msecs) : cell.offset;
+    cell.snapshot.update(snapshot.msecs, offset);
+    cell.count = m_face->collectRings(cell.snapshot, cell.rings);
+    if (m_face->smooth()) {
+        RadialClock::snapRings(cell.rings, cell.count, m_geometry);
+    }
+}
+
+const QPixmap *RadialClockWall::sprite(int i, const RadialClock::Ring &ring)
+{
+    // The angle is below 2^9 degrees, so 2^20 steps per degree fit the
+    // lower half of the key.
+    quint64 key = (quint64(i) << 32) | quint32(qRound(ring.angle * 1048576));
+    QPixmap *pixmap = m_sprites.object(key);
+    if (pixmap != NULL) {
+        return pixmap;
+    }
+
+    // The sprite is the square around the ring, the sector is centered in it.
+    const RadialClock::Geometry &g = m_geometry;
+    int R = g.radius(i) + g.thick + 1;
+    qreal ratio = devicePixelRatioF();
+    pixmap = new QPixmap(QSize(2*R, 2*R)*ratio);
+    pixmap->setDevicePixelRatio(ratio);
+    pixmap->fill(Qt::transparent);
+
+    QPainter painter(pixmap);
+    painter.setRenderHint(QPainter::Antialiasing);
+    if (ring.angle < 360) {
+        QPainterPath path;
+        RadialClock::sectorPath(path, R, R, g.radius(i), g.thick, ring.angle);
+        painter.fillPath(path, m_face->ringColor(ring));
+    }
+    painter.end();
+
+    // The cache may refuse (and delete) a sprite larger than its budget.
+    int cost = pixmap->width() * pixmap->height();
+    if (m_sprites.insert(key, pixmap, cost) == false) {
+        return NULL;
+    }
+    return pixmap;
+}
+
+void RadialClockWall::paintEvent(QPaintEvent *event)
+{
+    m_face->processColors();
+    m_face->updateGlyphs(font());
+
+    const RadialClock::Geometry &g = m_geometry;
+    const QRegion &clip = event->region();
+    QPainter painter(this);
+    painter.setPen(RadialClock::cBlack);
+    painter.setFont(font());
+
+    for(int index = 0; index < count(); index++)
+    {
+        QRect cr = cellRect(index);
+        if (clip.intersects(cr) == false) {
+            continue;
+        }
+
+        Cell &cell = m_cells[index];
+        QPoint center = cr.topLeft() + QPoint(g.x, g.y);
+        for(int i = 0; i < cell.count; i++)
+        {
+            int R = g.radius(i) + g.thick + 1;
+            QRect square(center.x() - R, center.y() - R, 2*R, 2*R);
+            if (clip.intersects(square) == false) {
+                continue;
+            }
+            const QPixmap *pixmap = sprite(i, cell.rings[i]);
+            if (pixmap != NULL) {
+                painter.drawPixmap(square.topLeft(), *pixmap);
+            }
+        }
+
+        if (cell.snapshot.date != cell.textDate) {
+            cell.textDate = cell.snapshot.date;
+            RadialClock::prepareDate(cell.dateText, cell.textDate, font());
+        }
+        qreal lineHeight = m_face->m_lineHeight;
+        qreal top = center.y() - lineHeight;
+        painter.drawStaticText(QPointF(center.x() - cell.dateText.size().width()/2, top), cell.dateText);
+        m_face->paintTime(painter, cell.snapshot.time,
+                          QPointF(center.x() - m_face->timeWidth()/2, top + lineHeight));
+    }
+}
+
+void RadialClockWall::resizeEvent(QResizeEvent *)
+{
+    relayout();
+}
+
+void RadialClockWall::showEvent(QShowEvent *)
+{
+    // Joining the ticker brings every cell up to date before the first paint.
+    setTicking(true);
+}
+
+void RadialClockWall::hideEvent(QHideEvent *)
+{
+    setTicking(false);
+}
+
+void RadialClockWall::setTicking(bool t)
+{
+    if (t == m_ticking) {
+        return;
+    }
+    m_ticking = t;
+    if (t) {
+        Ticker::instance()->attach(this);
+    } else {
+        Ticker::instance()->detach(this);
+    }
+}
+
+void RadialClockWall::tick(const RadialClock::TimeSnapshot &snapshot)
+{
+    const RadialClock::Geometry &g = m_geometry;
+    m_face->evaluateCountdowns(snapshot.msecs);
+
+    QRegion dirty;
+    for(int index = 0; index < count(); index++)
+    {
+        Cell &cell = m_cells[index];
+        QTime before = cell.snapshot.time;
+        RadialClock::ringArray rings = cell.rings;
+        advance(cell, snapshot);
+
+        // As for a single clock, the square around the outermost ring that
+        // moved covers the rings inside it, and the text needs a redraw
+        // every second.
+        int changed = -1;
+        for(int i = 0; i < cell.count; i++)
+        {
+            if (cell.rings[i].angle != rings[i].angle) {
+                changed = i;
+            }
+        }
+        if (changed < 0 && before.second() == cell.snapshot.time.second()) {
+            continue;
+        }
+
+        qreal textWidth = std::max(m_face->timeWidth(), cell.dateText.size().width());
+        int R = g.radius(std::max(0, changed)) + g.thick + 1;
+        R = std::max(R, int(std::max(textWidth/2, m_face->m_lineHeight)) + 1);
+        QPoint center = cellRect(index).topLeft() + QPoint(g.x, g.y);
+        dirty += QRect(center.x() - R, center.y() - R, 2*R, 2*R);
+    }
+
+    if (dirty.isEmpty() == false) {
+        update(dirty);
+    }
+}
+
+int RadialClockWall::dueIn(const RadialClock::TimeSnapshot &) const
+{
+    // The cells may sit in different days, so each one may blip on its own.
+    int wait = 1000;
+    for(cellVector::const_iterator it(m_cells.begin());
+        it != m_cells.end(); it++) {
+        wait = std::min(wait, m_face->nextChange(it->snapshot));
+    }
+    return wait;
+}
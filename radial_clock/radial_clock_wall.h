@@ -0,0 +1,138 @@
+/****************************************************************************
+**
+** Copyright (C) 2018 Brian Hill
+** All rights reserved.
+**
+** License Agreement
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** Software Author: Brian Hill <brian.hill@glowfish.ca>
+**
+** Summary: Header for a wall of radial clocks painted by a single widget
+**
+****************************************************************************/
+
+#ifndef RADIAL_CLOCK_WALL_H
+#define RADIAL_CLOCK_WALL_H
+
+#include "radial_clock.h"
+#include "ticker.h"
+#include "zone_table.h"
+
+#include <QWidget>
+#include <QCache>
+#include <QStaticText>
+#include <vector>
+#include <QtDesigner/QDesignerExportWidget>
+
+class QDESIGNER_WIDGET_EXPORT RadialClockWall : public QWidget, public TickClient
+{
+    Q_OBJECT
+    Q_PROPERTY(int columns READ columns WRITE setColumns);
+
+public:
+    explicit RadialClockWall(QWidget *parent = 0);
+    ~RadialClockWall();
+
+    /************************************************************************
+    ** Encapsulated Properties
+    ** - columns -- The number of clocks in each row, 0 to keep the grid
+    **   close to square.
+    ** - face -- The clock whose rings, colors and blip setting are shared
+    **   by every clock of the wall. It is never shown itself.
+    ************************************************************************/
+    int columns() const { return m_columns; }
+    void setColumns(int c);
+
+    RadialClock *face() const { return m_face; }
+
+    /************************************************************************
+    ** Clocks
+    ** Every clock of the wall shows the shared time either shifted to its
+    ** own fixed offset from UTC (in seconds) or in its own time zone (an
+    ** IANA id), which takes precedence when set.
+    ************************************************************************/
+    int count() const { return int(m_cells.size()); }
+    int addClock(int offset = 0);
+    int addClock(const QString &zone);
+    void removeClock(int index);
+    int offset(int index) const { return m_cells[index].offset; }
+    void setOffset(int index, int offset);
+    QString zone(int index) const;
+    void setZone(int index, const QString &zone);
+
+protected:
+    /************************************************************************
+    ** Widget Callbacks
+    ************************************************************************/
+    void paintEvent(QPaintEvent *event);
+    void resizeEvent(QResizeEvent *);
+    void showEvent(QShowEvent *);
+    void hideEvent(QHideEvent *);
+
+private:
+    /************************************************************************
+    ** Cell - The state of one clock of the wall, as of the last tick.
+    ************************************************************************/
+    struct Cell {
+        Cell() : offset(0), zone(NULL), count(0) {}
+
+        int offset;
+        const ZoneTable *zone;
+        RadialClock::TimeSnapshot snapshot;
+        RadialClock::ringArray rings;
+        int count;
+        QDate textDate;
+        QStaticText dateText;
+    };
+    typedef std::vector<Cell> cellVector;
+
+    /************************************************************************
+    ** Internal Variables.
+    ************************************************************************/
+    RadialClock *m_face;
+    int m_columns;
+    cellVector m_cells;
+    QSize m_cellSize;
+    RadialClock::Geometry m_geometry;
+    QCache<quint64, QPixmap> m_sprites;
+    bool m_ticking;
+
+    /************************************************************************
+    ** Sprite Cache
+    ** A ring with a given elapsed angle looks the same in every cell, so
+    ** each one is rendered once into a sprite and blitted everywhere. The
+    ** sprites are keyed by the exact angle (to a millionth of a degree) so
+    ** the smooth mode keeps its sub-degree steps. The cache is emptied
+    ** when the size or the face changes.
+    ************************************************************************/
+    const QPixmap *sprite(int i, const RadialClock::Ring &ring);
+    void relayout();
+
+    int columnCount() const;
+    QRect cellRect(int index) const;
+    void advance(Cell &cell, const RadialClock::TimeSnapshot &snapshot);
+
+    /************************************************************************
+    ** Scheduling
+    ** The wall joins the shared Ticker itself while it is shown, each tick
+    ** only invalidates the part of each cell that moved.
+    ************************************************************************/
+    void tick(const RadialClock::TimeSnapshot &snapshot);
+    int dueIn(const RadialClock::TimeSnapshot &snapshot) const;
+    void setTicking(bool t);
+
+private slots:
+    void restyle();
+};
+
+#endif // RADIAL_CLOCK_WALL_H
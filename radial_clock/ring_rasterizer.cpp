@@ -0,0 +1,301 @@
+/****************************************************************************
+**
+** Copyright (C) 2018 Brian Hill
+** All rights reserved.
+**
+** License Agreement
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** Software Author: Brian Hill <brian.hill@glowfish.ca>
+**
+** Summary: Software rasterizer of the radial clock rings
+**
+****************************************************************************/
+
+#include "ring_rasterizer.h"
+
+#include <algorithm>
+#include <math.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define RING_RASTERIZER_X86
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// The number of pixels whose coverage is computed in one go.
+const int cChunk = 64;
+
+/************************************************************************
+** The shape of the sector, relative to the center of the ring. The
+** elapsed part is bounded by the ray pointing up and the ray at the
+** elapsed angle; the signed distance to the first is px, the signed
+** distance to the second is px*cosA + py*sinA.
+************************************************************************/
+enum Mode {
+    Full,   // Nothing has elapsed.
+    Minor,  // Up to half of the ring has elapsed, cut the elapsed wedge out.
+    Major   // More than half has elapsed, keep only the remaining wedge.
+};
+
+struct Sector {
+    float inner;
+    float outer;
+    float cosA;
+    float sinA;
+    Mode mode;
+};
+
+typedef void (*coverageFunction)(float *out, int n, float px, float py, const Sector &s);
+
+inline float clamp01(float v)
+{
+    return std::min(1.0f, std::max(0.0f, v));
+}
+
+void coverageScalar(float *out, int n, float px, float py, const Sector &s)
+{
+    float py2 = py*py;
+    float pySinA = py*s.sinA;
+    for(int i = 0; i < n; i++, px += 1.0f) {
+        float d = sqrtf(px*px + py2);
+        float c = clamp01(s.outer + 0.5f - d) * clamp01(d - s.inner + 0.5f);
+        float sa = px*s.cosA + pySinA;
+        if (s.mode == Minor) {
+            c *= 1.0f - clamp01(px + 0.5f) * clamp01(0.5f - sa);
+        } else if (s.mode == Major) {
+            c *= clamp01(sa + 0.5f) * clamp01(0.5f - px);
+        }
+        out[i] = c;
+    }
+}
+
+#ifdef RING_RASTERIZER_X86
+__attribute__((target("sse2")))
+inline __m128 clamp01(__m128 v)
+{
+    return _mm_min_ps(_mm_set1_ps(1.0f), _mm_max_ps(_mm_setzero_ps(), v));
+}
+
+__attribute__((target("sse2")))
+void coverageSSE2(float *out, int n, float px, float py, const Sector &s)
+{
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128 inner = _mm_set1_ps(s.inner - 0.5f);
+    const __m128 outer = _mm_set1_ps(s.outer + 0.5f);
+    const __m128 cosA = _mm_set1_ps(s.cosA);
+    const __m128 pySinA = _mm_set1_ps(py*s.sinA);
+    const __m128 py2 = _mm_set1_ps(py*py);
+    const __m128 step = _mm_set1_ps(4.0f);
+
+    __m128 x = _mm_add_ps(_mm_set1_ps(px), _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f));
+    int i = 0;
+    for(; i + 4 <= n; i += 4, x = _mm_add_ps(x, step)) {
+        __m128 d = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(x, x), py2));
+        __m128 c = _mm_mul_ps(clamp01(_mm_sub_ps(outer, d)), clamp01(_mm_sub_ps(d, inner)));
+        __m128 sa = _mm_add_ps(_mm_mul_ps(x, cosA), pySinA);
+        if (s.mode == Minor) {
+            __m128 e = _mm_mul_ps(clamp01(_mm_add_ps(x, half)), clamp01(_mm_sub_ps(half, sa)));
+            c = _mm_mul_ps(c, _mm_sub_ps(one, e));
+        } else if (s.mode == Major) {
+            c = _mm_mul_ps(c, _mm_mul_ps(clamp01(_mm_add_ps(sa, half)), clamp01(_mm_sub_ps(half, x))));
+        }
+        _mm_storeu_ps(out + i, c);
+    }
+    coverageScalar(out + i, n - i, px + i, py, s);
+}
+
+__attribute__((target("avx2")))
+inline __m256 clamp01(__m256 v)
+{
+    return _mm256_min_ps(_mm256_set1_ps(1.0f), _mm256_max_ps(_mm256_setzero_ps(), v));
+}
+
+__attribute__((target("avx2")))
+void coverageAVX2(float *out, int n, float px, float py, const Sector &s)
+{
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 half = _mm256_set1_ps(0.5f);
+    const __m256 inner = _mm256_set1_ps(s.inner - 0.5f);
+    const __m256 outer = _mm256_set1_ps(s.outer + 0.5f);
+    const __m256 cosA = _mm256_set1_ps(s.cosA);
+    const __m256 pySinA = _mm256_set1_ps(py*s.sinA);
+    const __m256 py2 = _mm256_set1_ps(py*py);
+    const __m256 step = _mm256_set1_ps(8.0f);
+
+    __m256 x = _mm256_add_ps(_mm256_set1_ps(px),
+                             _mm256_set_ps(7.0f, 6.0f, 5.0f, 4.0f, 3.0f, 2.0f, 1.0f, 0.0f));
+    int i = 0;
+    for(; i + 8 <= n; i += 8, x = _mm256_add_ps(x, step)) {
+        __m256 d = _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(x, x), py2));
+        __m256 c = _mm256_mul_ps(clamp01(_mm256_sub_ps(outer, d)), clamp01(_mm256_sub_ps(d, inner)));
+        __m256 sa = _mm256_add_ps(_mm256_mul_ps(x, cosA), pySinA);
+        if (s.mode == Minor) {
+            __m256 e = _mm256_mul_ps(clamp01(_mm256_add_ps(x, half)), clamp01(_mm256_sub_ps(half, sa)));
+            c = _mm256_mul_ps(c, _mm256_sub_ps(one, e));
+        } else if (s.mode == Major) {
+            c = _mm256_mul_ps(c, _mm256_mul_ps(clamp01(_mm256_add_ps(sa, half)), clamp01(_mm256_sub_ps(half, x))));
+        }
+        _mm256_storeu_ps(out + i, c);
+    }
+    coverageScalar(out + i, n - i, px + i, py, s);
+}
+#endif
+
+coverageFunction coverage(RingRasterizer::Backend b)
+{
+#ifdef RING_RASTERIZER_X86
+    switch(b) {
+        case RingRasterizer::AVX2:
+            return coverageAVX2;
+            break;
+        case RingRasterizer::SSE2:
+            return coverageSSE2;
+            break;
+        default:
+            break;
+    }
+#else
+    Q_UNUSED(b);
+#endif
+    return coverageScalar;
+}
+
+// Multiply every channel of a premultiplied pixel by a (0 - 256).
+inline quint32 byteMul(quint32 x, uint a)
+{
+    quint32 t = (x & 0xff00ff) * a;
+    t = (t >> 8) & 0xff00ff;
+    x = ((x >> 8) & 0xff00ff) * a;
+    x = x & 0xff00ff00;
+    return x | t;
+}
+
+void blend(quint32 *dst, const float *coverage, int n, quint32 color)
+{
+    bool opaque = (qAlpha(color) == 255);
+    for(int i = 0; i < n; i++) {
+        uint a = uint(coverage[i]*256.0f + 0.5f);
+        if (a == 0) {
+            continue;
+        }
+        if (a >= 256 && opaque) {
+            dst[i] = color;
+            continue;
+        }
+        quint32 src = byteMul(color, std::min(a, 256u));
+        dst[i] = src + byteMul(dst[i], 256 - qAlpha(src));
+    }
+}
+
+void span(quint32 *line, int from, int to, float cx, float py,
+          const Sector &s, coverageFunction f, quint32 color)
+{
+    float buffer[cChunk];
+    for(int x = from; x < to; x += cChunk) {
+        int n = std::min(cChunk, to - x);
+        f(buffer, n, x + 0.5f - cx, py, s);
+        blend(line + x, buffer, n, color);
+    }
+}
+
+} // end namespace
+
+/************************************************************************
+** Constants
+************************************************************************/
+RingRasterizer::Backend RingRasterizer::s_backend = RingRasterizer::bestBackend();
+
+RingRasterizer::Backend RingRasterizer::backend()
+{
+    return s_backend;
+}
+
+RingRasterizer::Backend RingRasterizer::bestBackend()
+{
+#ifdef RING_RASTERIZER_X86
+    // This may run before the constructors of the runtime library.
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return AVX2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return SSE2;
+    }
+#endif
+    return Scalar;
+}
+
+void RingRasterizer::setBackend(Backend b)
+{
+    s_backend = std::min(b, bestBackend());
+}
+
+void RingRasterizer::fill(QImage &image, const QPointF &center, qreal inner, qreal outer,
+                          qreal angle, const QColor &color)
+{
+    if (image.format() != QImage::Format_ARGB32_Premultiplied ||
+        angle >= 360 || outer <= inner) {
+        return;
+    }
+
+    Sector s;
+    s.inner = inner;
+    s.outer = outer;
+    s.cosA = cos(angle * M_PI / 180);
+    s.sinA = sin(angle * M_PI / 180);
+    s.mode = (angle <= 0) ? Full : (angle <= 180) ? Minor : Major;
+
+    coverageFunction f = coverage(s_backend);
+    quint32 clr = qPremultiply(color.rgba());
+    float cx = center.x();
+    float cy = center.y();
+
+    // Pixel centers further than this from the center are not covered.
+    float reach = outer + 0.5f;
+    // Pixel centers closer than this to the center are not covered.
+    float hole = inner - 0.5f;
+
+    int W = image.width();
+    int y0 = std::max(0, int(floorf(cy - reach)));
+    int y1 = std::min(image.height(), int(ceilf(cy + reach)));
+    for(int y = y0; y < y1; y++) {
+        float py = y + 0.5f - cy;
+        float py2 = py*py;
+        if (py2 >= reach*reach) {
+            continue;
+        }
+
+        float w = sqrtf(reach*reach - py2);
+        int x0 = std::max(0, int(floorf(cx - w)));
+        int x1 = std::min(W, int(ceilf(cx + w)));
+
+        // Skip the run of pixels inside the hole of the ring.
+        int h0 = x1;
+        int h1 = x1;
+        if (hole > 0 && py2 < hole*hole) {
+            float h = sqrtf(hole*hole - py2);
+            h0 = std::max(x0, int(ceilf(cx - h - 0.5f)));
+            h1 = std::min(x1, int(floorf(cx + h - 0.5f)) + 1);
+            if (h0 >= h1) {
+                h0 = x1;
+                h1 = x1;
+            }
+        }
+
+        quint32 *line = reinterpret_cast<quint32*>(image.scanLine(y));
+        span(line, x0, h0, cx, py, s, f, clr);
+        span(line, h1, x1, cx, py, s, f, clr);
+    }
+}
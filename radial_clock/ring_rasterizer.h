@@ -0,0 +1,65 @@
+/****************************************************************************
+**
+** Copyright (C) 2018 Brian Hill
+** All rights reserved.
+**
+** License Agreement
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** Software Author: Brian Hill <brian.hill@glowfish.ca>
+**
+** Summary: Header for the software rasterizer of the radial clock rings
+**
+****************************************************************************/
+
+#ifndef RING_RASTERIZER_H
+#define RING_RASTERIZER_H
+
+#include <QImage>
+#include <QColor>
+#include <QPointF>
+
+class RingRasterizer
+{
+public:
+    /************************************************************************
+    ** Backend - The instruction set used to compute the ring coverage. The
+    ** best one supported by the CPU is picked at runtime.
+    ************************************************************************/
+    enum Backend {
+        Scalar = 0,
+        SSE2 = 1,
+        AVX2 = 2
+    };
+
+    static Backend backend();
+    static Backend bestBackend();
+    static void setBackend(Backend b);
+
+    /************************************************************************
+    ** Blend the remaining part of a ring into an ARGB32 premultiplied image.
+    ** - center -- The center of the ring, in pixels.
+    ** - inner -- The inner radius, in pixels.
+    ** - outer -- The outer radius, in pixels.
+    ** - angle -- The elapsed angle, in degrees clockwise from the top.
+    ** - color -- The color of the ring.
+    ** Note: the coverage of every pixel is computed analytically from its
+    ** distance to the ring edges, so the edges come out antialiased.
+    ************************************************************************/
+    static void fill(QImage &image, const QPointF &center, qreal inner, qreal outer,
+                     qreal angle, const QColor &color);
+
+private:
+    static Backend s_backend;
+};
+
+#endif // RING_RASTERIZER_H
@@ -0,0 +1,91 @@
+/****************************************************************************
+**
+** Copyright (C) 2018 Brian Hill
+** All rights reserved.
+**
+** License Agreement
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** Software Author: Brian Hill <brian.hill@glowfish.ca>
+**
+** Summary: Perceptual image comparison of the tests
+**
+****************************************************************************/
+
+#include "image_compare.h"
+
+#include <math.h>
+#include <algorithm>
+
+/************************************************************************
+** Constructor/Destructor
+************************************************************************/
+ImageCompare::ImageCompare(qreal threshold, qreal fraction) :
+    m_threshold(threshold),
+    m_fraction(fraction),
+    m_differing(0),
+    m_worst(0)
+{
+}
+
+/************************************************************************
+** The distance of two premultiplied pixels, the color channels weighted
+** by how much they contribute to the perceived brightness, or the change
+** in coverage if that is larger.
+************************************************************************/
+qreal ImageCompare::distance(QRgb a, QRgb b)
+{
+    qreal dr = (qRed(a) - qRed(b))/255.0;
+    qreal dg = (qGreen(a) - qGreen(b))/255.0;
+    qreal db = (qBlue(a) - qBlue(b))/255.0;
+    qreal da = qAbs(qAlpha(a) - qAlpha(b))/255.0;
+    return std::max(sqrt(0.299*dr*dr + 0.587*dg*dg + 0.114*db*db), da);
+}
+
+bool ImageCompare::compare(const QImage &actual, const QImage &expected)
+{
+    m_differing = 0;
+    m_worst = 0;
+    m_diff = QImage();
+    if (actual.size() != expected.size()) {
+        m_report = QString("size %1x%2 instead of %3x%4")
+                   .arg(actual.width()).arg(actual.height())
+                   .arg(expected.width()).arg(expected.height());
+        return false;
+    }
+
+    QImage a = actual.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    QImage e = expected.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    m_diff = QImage(e.size(), QImage::Format_RGB32);
+    for(int y = 0; y < e.height(); y++) {
+        const QRgb *al = reinterpret_cast<const QRgb*>(a.constScanLine(y));
+        const QRgb *el = reinterpret_cast<const QRgb*>(e.constScanLine(y));
+        QRgb *dl = reinterpret_cast<QRgb*>(m_diff.scanLine(y));
+        for(int x = 0; x < e.width(); x++) {
+            qreal d = distance(al[x], el[x]);
+            m_worst = std::max(m_worst, d);
+            if (d > m_threshold) {
+                m_differing++;
+                dl[x] = qRgb(128 + int(127*d), 0, 0);
+            } else {
+                int g = qGray(el[x])/3;
+                dl[x] = qRgb(g, g, g);
+            }
+        }
+    }
+
+    int allowed = int(m_fraction * e.width() * e.height());
+    m_report = QString("%1 of %2 pixels differ by more than %3 (worst %4, %5 allowed)")
+               .arg(m_differing).arg(e.width() * e.height())
+               .arg(m_threshold).arg(m_worst, 0, 'f', 3).arg(allowed);
+    return m_differing <= allowed;
+}
@@ -0,0 +1,70 @@
+/****************************************************************************
+**
+** Copyright (C) 2018 Brian Hill
+** All rights reserved.
+**
+** License Agreement
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** Software Author: Brian Hill <brian.hill@glowfish.ca>
+**
+** Summary: Header for the perceptual image comparison of the tests
+**
+****************************************************************************/
+
+#ifndef IMAGE_COMPARE_H
+#define IMAGE_COMPARE_H
+
+#include <QImage>
+#include <QString>
+
+class ImageCompare
+{
+public:
+    /************************************************************************
+    ** - threshold -- The perceptual distance (0 - 1) above which a pixel
+    **   counts as different, 0 to count any difference.
+    ** - fraction -- The share of the pixels that may differ, to allow for
+    **   antialiasing noise.
+    ************************************************************************/
+    explicit ImageCompare(qreal threshold, qreal fraction);
+
+    /************************************************************************
+    ** Compare two images of the same size, any format. The results of the
+    ** last comparison are kept.
+    ** - differing -- The number of pixels that differ.
+    ** - worst -- The largest perceptual distance found.
+    ** - diff -- The expected image dimmed, with the differing pixels in red.
+    ** - report -- A one line summary of the comparison.
+    ************************************************************************/
+    bool compare(const QImage &actual, const QImage &expected);
+
+    int differing() const { return m_differing; }
+    qreal worst() const { return m_worst; }
+    const QImage &diff() const { return m_diff; }
+    const QString &report() const { return m_report; }
+
+    static qreal distance(QRgb a, QRgb b);
+
+private:
+    /************************************************************************
+    ** Internal Variables.
+    ************************************************************************/
+    qreal m_threshold;
+    qreal m_fraction;
+    int m_differing;
+    qreal m_worst;
+    QImage m_diff;
+    QString m_report;
+};
+
+#endif // IMAGE_COMPARE_H
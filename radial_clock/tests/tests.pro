@@ -0,0 +1,47 @@
+#-------------------------------------------------
+#
+# Copyright (C) 2018 Brian Hill
+# All rights reserved
+#
+# License Agreement
+#
+# This program is free software: you can distribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# any later version
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY of FITNESS FOR A PARTICULAR PURPOSE. See the
+# GNU General Public License for more details.
+#
+# Software Author: Brian Hill <brian.hill@glowfish.ca>
+#
+# Tests of the radial clock, run without a display (the offscreen platform
+# is picked unless QT_QPA_PLATFORM is set) with "make check".
+#
+# The golden image tests compare the renderings with the reference PNGs in
+# golden/. Failures leave the actual, expected and diff images in the
+# directory named by RADIAL_CLOCK_GOLDEN_OUT (golden_failures by default).
+# Rows without a reference are skipped. Write the references on the
+# platform the tests run on, and again after an intended visual change:
+#   RADIAL_CLOCK_GOLDEN_UPDATE=1 ./tst_radial_clock
+#
+#-------------------------------------------------
+
+QT += widgets designer concurrent testlib
+
+CONFIG += console testcase
+CONFIG -= app_bundle
+
+TARGET = tst_radial_clock
+TEMPLATE = app
+
+DEFINES += SRCDIR=\\\"$$PWD/\\\"
+
+include(../radial_clock.pri)
+
+SOURCES += tst_radial_clock.cpp \
+    image_compare.cpp
+
+HEADERS += image_compare.h
@@ -0,0 +1,513 @@
+/****************************************************************************
+**
+** Copyright (C) 2018 Brian Hill
+** All rights reserved.
+**
+** License Agreement
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** Software Author: Brian Hill <brian.hill@glowfish.ca>
+**
+** Summary: Tests of the radial clock
+**
+****************************************************************************/
+
+#include "radial_clock.h"
+#include "time_source.h"
+#include "ring_rasterizer.h"
+#include "image_compare.h"
+
+#include <QApplication>
+#include <QDir>
+#include <QPainter>
+#include <QScreen>
+#include <QWindow>
+#include <QtTest>
+#include <new>
+#include <stdlib.h>
+
+namespace {
+    // A pixel counts as changed once it is about one tenth of the way from
+    // black to white, and a few of those are allowed for the antialiasing
+    // of the edges and the glyphs on another platform or Qt version.
+    const qreal cThreshold = 0.1;
+    const qreal cFraction = 0.002;
+
+    // The software rasterizer computes its coverage analytically where
+    // QPainter samples it, so their edge pixels are allowed to differ more,
+    // but only along the edges.
+    const qreal cRasterThreshold = 0.25;
+    const qreal cRasterFraction = 0.01;
+
+    /************************************************************************
+    ** The configurations and instants the golden images are taken from.
+    ** blip -- The end of a month, every ring blips.
+    ** leap -- The last moment of a leap day.
+    ** plain -- An instant without anything special about it.
+    ************************************************************************/
+    const char *cConfigs[] = { "gradient", "rainbow", "custom", "software" };
+    const int cConfigCount = 4;
+
+    struct Instant {
+        const char *name;
+        QDateTime dtime;
+    };
+    const Instant cInstants[] = {
+        { "blip", QDateTime(QDate(2019, 6, 30), QTime(23, 59, 59, 900), Qt::UTC) },
+        { "leap", QDateTime(QDate(2020, 2, 29), QTime(23, 59, 59, 950), Qt::UTC) },
+        { "plain", QDateTime(QDate(2019, 7, 4), QTime(12, 34, 56, 0), Qt::UTC) },
+    };
+    const int cInstantCount = 3;
+
+    void configure(RadialClock &clock, const QString &config)
+    {
+        if (config == "rainbow") {
+            clock.setRainbow(true);
+        } else if (config == "custom") {
+            clock.setInnerColor(QColor(0, 160, 0));
+            clock.setOuterColor(QColor(200, 0, 200));
+            clock.setBlip(false);
+            clock.setMinutes(false);
+            clock.setWeekDays(false);
+            clock.setYearDays(false);
+        } else if (config == "software") {
+            clock.setSoftwareRaster(true);
+        }
+    }
+
+    /************************************************************************
+    ** The clock as the screen shows it, through the ticker and paintEvent.
+    ************************************************************************/
+    QImage renderLive(const QString &config, const QDateTime &dtime, const QSize &size)
+    {
+        RadialClock::setTimeSource(new FixedTimeSource(dtime));
+        RadialClock clock;
+        configure(clock, config);
+        clock.resize(size);
+        clock.show();
+        if (QTest::qWaitForWindowExposed(&clock) == false) {
+            return QImage();
+        }
+        return clock.grab().toImage();
+    }
+
+    /************************************************************************
+    ** The clock as renderAt draws it, without a window.
+    ************************************************************************/
+    QImage renderHeadless(const QString &config, const QDateTime &dtime, const QSize &size)
+    {
+        RadialClock clock;
+        configure(clock, config);
+        return clock.renderAt(dtime, size);
+    }
+
+    /************************************************************************
+    ** Allocation counting, every operator new is counted while
+    ** countAllocations is set (see the replacements below main).
+    ************************************************************************/
+    QAtomicInt countAllocations;
+    QAtomicInt allocationCount;
+
+    // A widget that only opens a painter, the allocations every repaint
+    // makes before the clock draws anything.
+    class PainterOnly : public QWidget
+    {
+    protected:
+        void paintEvent(QPaintEvent *) { QPainter painter(this); }
+    };
+
+    bool showWidget(QWidget &widget, const QSize &size)
+    {
+        widget.resize(size);
+        widget.show();
+        return QTest::qWaitForWindowExposed(&widget);
+    }
+
+    // The allocations of one repaint.
+    int countRepaint(QWidget &widget)
+    {
+        allocationCount.store(0);
+        countAllocations.store(1);
+        widget.repaint();
+        countAllocations.store(0);
+        return allocationCount.load();
+    }
+
+    // Move the time on and let the ticker hand it to the clocks.
+    void step(FixedTimeSource *source, QDateTime &now, int msecs)
+    {
+        now = now.addMSecs(msecs);
+        source->setTime(now);
+        RadialClock::refreshTime();
+    }
+
+    // The allocations of rebuilding and filling one sector path, which the
+    // smooth mode does for a ring that moved.
+    int countPathRebuild()
+    {
+        QImage image(240, 240, QImage::Format_ARGB32_Premultiplied);
+        QPainter painter(&image);
+        painter.setRenderHint(QPainter::Antialiasing);
+        QBrush brush(Qt::red);
+        QPainterPath first;
+        RadialClock::sectorPath(first, 120, 120, 60, 10, 100);
+        painter.fillPath(first, brush);
+
+        allocationCount.store(0);
+        countAllocations.store(1);
+        {
+            QPainterPath path;
+            RadialClock::sectorPath(path, 120, 120, 60, 10, 101);
+            painter.fillPath(path, brush);
+        }
+        countAllocations.store(0);
+        return allocationCount.load();
+    }
+
+    QString outputDir()
+    {
+        QString dir = qEnvironmentVariable("RADIAL_CLOCK_GOLDEN_OUT", "golden_failures");
+        QDir().mkpath(dir);
+        return dir + "/";
+    }
+}
+
+class TestRadialClock : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void cleanup();
+
+    void golden_data();
+    void golden();
+    void dirtyRegions();
+    void allocations_data();
+    void allocations();
+    void softwareRaster_data();
+    void softwareRaster();
+    void snapshotOffset_data();
+    void snapshotOffset();
+};
+
+void TestRadialClock::cleanup()
+{
+    RadialClock::setTimeSource(NULL);
+}
+
+/************************************************************************
+** Each configuration at each instant, then the plain clock at a few other
+** sizes, through both the live and the headless path. The two paths lay
+** out the date differently (glyph cells against drawText) so each has its
+** own reference.
+************************************************************************/
+void TestRadialClock::golden_data()
+{
+    QTest::addColumn<QString>("config");
+    QTest::addColumn<QDateTime>("dtime");
+    QTest::addColumn<QSize>("size");
+    QTest::addColumn<bool>("live");
+
+    const char *paths[] = { "headless", "live" };
+    for(int live = 0; live < 2; live++) {
+        for(int i = 0; i < cConfigCount; i++) {
+            for(int j = 0; j < cInstantCount; j++) {
+                QString name = QString("%1-%2-200x200-%3").arg(cConfigs[i]).arg(cInstants[j].name).arg(paths[live]);
+                QTest::newRow(qPrintable(name)) << QString(cConfigs[i]) << cInstants[j].dtime << QSize(200, 200) << bool(live);
+            }
+        }
+        const QSize sizes[] = { QSize(64, 64), QSize(400, 300), QSize(640, 640) };
+        for(int i = 0; i < 3; i++) {
+            QString name = QString("gradient-plain-%1x%2-%3").arg(sizes[i].width()).arg(sizes[i].height()).arg(paths[live]);
+            QTest::newRow(qPrintable(name)) << QString("gradient") << cInstants[2].dtime << sizes[i] << bool(live);
+        }
+    }
+}
+
+void TestRadialClock::golden()
+{
+    QFETCH(QString, config);
+    QFETCH(QDateTime, dtime);
+    QFETCH(QSize, size);
+    QFETCH(bool, live);
+
+    QImage actual = live ? renderLive(config, dtime, size) : renderHeadless(config, dtime, size);
+    QVERIFY2(actual.isNull() == false, "the clock rendered nothing");
+
+    QString name = QTest::currentDataTag();
+    QString reference = QString(SRCDIR "golden/%1.png").arg(name);
+    if (qEnvironmentVariableIntValue("RADIAL_CLOCK_GOLDEN_UPDATE")) {
+        QDir().mkpath(SRCDIR "golden");
+        QVERIFY2(actual.save(reference), qPrintable("cannot write " + reference));
+        return;
+    }
+
+    // The references depend on the fonts and the platform, so they are
+    // generated where the tests run rather than shipped.
+    QImage expected(reference);
+    if (expected.isNull()) {
+        actual.save(outputDir() + name + "-actual.png");
+        QSKIP(qPrintable("no reference image " + reference + ", run with RADIAL_CLOCK_GOLDEN_UPDATE=1 to write it"));
+    }
+
+    ImageCompare compare(cThreshold, cFraction);
+    if (compare.compare(actual, expected) == false) {
+        QString out = outputDir() + name;
+        actual.save(out + "-actual.png");
+        expected.save(out + "-expected.png");
+        if (compare.diff().isNull() == false) {
+            compare.diff().save(out + "-diff.png");
+        }
+        QFAIL(qPrintable(compare.report() + ", see " + out + "-diff.png"));
+    }
+}
+
+/************************************************************************
+** Step the time through a blip and the rollover of a month, and check
+** after each step that what the partial repaints left on the window is
+** exactly what a full repaint draws.
+************************************************************************/
+void TestRadialClock::dirtyRegions()
+{
+    QDateTime start(QDate(2019, 6, 30), QTime(23, 59, 58, 700), Qt::UTC);
+    FixedTimeSource *source = new FixedTimeSource(start);
+    RadialClock::setTimeSource(source);
+    RadialClock clock;
+    clock.resize(240, 240);
+    clock.show();
+    QVERIFY(QTest::qWaitForWindowExposed(&clock));
+    QScreen *screen = clock.windowHandle()->screen();
+
+    ImageCompare compare(0, 0);
+    for(int step = 1; step <= 30; step++) {
+        QDateTime dtime = start.addMSecs(step * 100);
+        source->setTime(dtime);
+        RadialClock::refreshTime();
+        QCoreApplication::processEvents();
+
+        QImage shown = screen->grabWindow(clock.winId()).toImage();
+        if (shown.isNull()) {
+            QSKIP("the platform cannot grab the window contents");
+        }
+        QImage full = clock.grab().toImage();
+        if (compare.compare(shown, full) == false) {
+            QString out = outputDir() + "dirty-" + QString::number(step);
+            shown.save(out + "-shown.png");
+            full.save(out + "-full.png");
+            if (compare.diff().isNull() == false) {
+                compare.diff().save(out + "-diff.png");
+            }
+            QFAIL(qPrintable(dtime.toString(Qt::ISODateWithMs) + ": " + compare.report()));
+        }
+    }
+}
+
+/************************************************************************
+** The repaint after a tick must not allocate more than opening the
+** painter does: the paths of every step, the brushes, pen, glyphs and
+** layer are all kept from the minute of ticks before. The smooth mode
+** rebuilds the path of a ring that moved (unless rasterizing), so it may
+** allocate that much more.
+************************************************************************/
+void TestRadialClock::allocations_data()
+{
+    QTest::addColumn<bool>("smooth");
+    QTest::addColumn<bool>("softwareRaster");
+
+    QTest::newRow("stepping") << false << false;
+    QTest::newRow("stepping/software") << false << true;
+    QTest::newRow("smooth") << true << false;
+    QTest::newRow("smooth/software") << true << true;
+}
+
+void TestRadialClock::allocations()
+{
+    QFETCH(bool, smooth);
+    QFETCH(bool, softwareRaster);
+
+    QDateTime now = cInstants[2].dtime;
+    FixedTimeSource *source = new FixedTimeSource(now);
+    RadialClock::setTimeSource(source);
+    PainterOnly baseline;
+    QVERIFY(showWidget(baseline, QSize(240, 240)));
+    RadialClock clock;
+    clock.setSmooth(smooth);
+    clock.setSoftwareRaster(softwareRaster);
+    QVERIFY(showWidget(clock, QSize(240, 240)));
+
+    // Paint every second of a whole minute once, so each step of the
+    // seconds ring has been seen.
+    baseline.repaint();
+    clock.repaint();
+    for(int i = 0; i < 60; i++) {
+        step(source, now, 1000);
+        clock.repaint();
+    }
+
+    int interval = (clock.frameStats().interval > 0) ? clock.frameStats().interval : 16;
+    step(source, now, smooth ? interval : 1000);
+    int used = countRepaint(clock);
+    int bare = countRepaint(baseline);
+    int allowed = bare + ((smooth && softwareRaster == false) ? countPathRebuild() : 0);
+    QVERIFY2(used <= allowed, qPrintable(QString("the repaint after a tick allocated %1 times, %2 allowed (a bare painter %3)")
+                                         .arg(used).arg(allowed).arg(bare)));
+}
+
+/************************************************************************
+** The software rasterizer against the QPainter path fills, with every
+** instruction set the CPU supports, at a few sizes and angles.
+************************************************************************/
+void TestRadialClock::softwareRaster_data()
+{
+    QTest::addColumn<QDateTime>("dtime");
+    QTest::addColumn<QSize>("size");
+
+    const QSize sizes[] = { QSize(64, 64), QSize(200, 200), QSize(640, 480), QSize(1200, 1200) };
+    for(int i = 0; i < 4; i++) {
+        for(int j = 0; j < cInstantCount; j++) {
+            QString name = QString("%1-%2x%3").arg(cInstants[j].name).arg(sizes[i].width()).arg(sizes[i].height());
+            QTest::newRow(qPrintable(name)) << cInstants[j].dtime << sizes[i];
+        }
+    }
+}
+
+void TestRadialClock::softwareRaster()
+{
+    QFETCH(QDateTime, dtime);
+    QFETCH(QSize, size);
+
+    RadialClock clock;
+    QImage expected = clock.renderAt(dtime, size);
+    clock.setSoftwareRaster(true);
+
+    const char *names[] = { "scalar", "sse2", "avx2" };
+    RingRasterizer::Backend best = RingRasterizer::bestBackend();
+    for(int b = RingRasterizer::Scalar; b <= best; b++) {
+        RingRasterizer::setBackend(RingRasterizer::Backend(b));
+        QImage actual = clock.renderAt(dtime, size);
+
+        ImageCompare compare(cRasterThreshold, cRasterFraction);
+        if (compare.compare(actual, expected) == false) {
+            RingRasterizer::setBackend(best);
+            QString out = outputDir() + "raster-" + QTest::currentDataTag() + "-" + names[b];
+            actual.save(out + "-actual.png");
+            expected.save(out + "-expected.png");
+            if (compare.diff().isNull() == false) {
+                compare.diff().save(out + "-diff.png");
+            }
+            QFAIL(qPrintable(QString(names[b]) + ": " + compare.report()));
+        }
+    }
+    RingRasterizer::setBackend(best);
+}
+
+/************************************************************************
+** A snapshot moved to an offset from UTC must match the one built from a
+** QDateTime at that offset, before and after the epoch and across days.
+************************************************************************/
+void TestRadialClock::snapshotOffset_data()
+{
+    QTest::addColumn<QDateTime>("dtime");
+    QTest::addColumn<int>("offset");
+
+    const int offsets[] = { 0, 3600, -5*3600, 5*3600 + 1800, -(9*3600 + 30*60), 13*3600 + 45*60 };
+    for(int j = 0; j < cInstantCount; j++) {
+        for(int i = 0; i < 6; i++) {
+            QTest::newRow(qPrintable(QString("%1/%2").arg(cInstants[j].name).arg(offsets[i]))) << cInstants[j].dtime << offsets[i];
+        }
+    }
+    QDateTime before(QDate(1969, 12, 31), QTime(23, 59, 59, 999), Qt::UTC);
+    QTest::newRow("beforeEpoch/0") << before << 0;
+    QTest::newRow("beforeEpoch/3600") << before << 3600;
+    QTest::newRow("beforeEpoch/-3600") << before.addSecs(3600) << -3600;
+}
+
+void TestRadialClock::snapshotOffset()
+{
+    QFETCH(QDateTime, dtime);
+    QFETCH(int, offset);
+
+    qint64 msecs = dtime.toMSecsSinceEpoch();
+    RadialClock::TimeSnapshot expected;
+    expected.update(QDateTime::fromMSecsSinceEpoch(msecs, Qt::OffsetFromUTC, offset));
+    RadialClock::TimeSnapshot actual;
+    actual.update(msecs, offset);
+
+    QCOMPARE(actual.msecs, expected.msecs);
+    QCOMPARE(actual.date, expected.date);
+    QCOMPARE(actual.time, expected.time);
+    for(int tc = 0; tc < RadialClock::InvalidTimeCode; tc++) {
+        QCOMPARE(actual.values[tc], expected.values[tc]);
+        QCOMPARE(actual.limits[tc], expected.limits[tc]);
+        QCOMPARE(actual.blips[tc], expected.blips[tc]);
+        QCOMPARE(actual.progress[tc], expected.progress[tc]);
+    }
+}
+
+/************************************************************************
+** The images must not depend on the display nor on the local time zone,
+** so the offscreen platform, UTC and a fixed font are set up before the
+** application starts.
+************************************************************************/
+int main(int argc, char *argv[])
+{
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    qputenv("TZ", "UTC");
+    QApplication app(argc, argv);
+    QApplication::setFont(QFont("DejaVu Sans", 9));
+    TestRadialClock test;
+    return QTest::qExec(&test, argc, argv);
+}
+
+/************************************************************************
+** The global allocation functions, counting for the allocation test.
+************************************************************************/
+void *operator new(std::size_t size)
+{
+    if (countAllocations.load()) {
+        allocationCount.ref();
+    }
+    void *p = malloc(size ? size : 1);
+    if (p == NULL) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void *operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *p) noexcept
+{
+    free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept
+{
+    free(p);
+}
+
+void operator delete[](void *p, std::size_t) noexcept
+{
+    free(p);
+}
+
+#include "tst_radial_clock.moc"
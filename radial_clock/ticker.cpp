@@ -0,0 +1,185 @@
+/****************************************************************************
+**
+** Copyright (C) 2018 Brian Hill
+** All rights reserved.
+**
+** License Agreement
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** Software Author: Brian Hill <brian.hill@glowfish.ca>
+**
+** Summary: Shared tick service driving every radial clock from one timer
+**
+****************************************************************************/
+
+#include "ticker.h"
+#include "radial_clock.h"
+
+#include <QCoreApplication>
+#include <limits>
+#include <math.h>
+
+namespace {
+    // Margin added to every deadline so the timer never wakes just before it.
+    const int cDeadlineSlack = 1;
+}
+
+/************************************************************************
+** Constants
+************************************************************************/
+Ticker *Ticker::s_instance = NULL;
+
+/************************************************************************
+** TickClient
+************************************************************************/
+TickClient::~TickClient()
+{
+}
+
+/************************************************************************
+** Constructor/Destructor
+************************************************************************/
+Ticker::Ticker(QObject *parent) :
+    QObject(parent),
+    m_source(new RealTimeSource),
+    m_nowMsecs(0),
+    m_wakeups(0)
+{
+    m_timer.setSingleShot(true);
+    m_timer.setTimerType(Qt::PreciseTimer);
+    connect(&m_timer, SIGNAL(timeout()), this, SLOT(tick()));
+    read();
+}
+
+Ticker::~Ticker()
+{
+    if (s_instance == this) {
+        s_instance = NULL;
+    }
+    delete m_source;
+}
+
+Ticker *Ticker::instance()
+{
+    if (s_instance == NULL) {
+        s_instance = new Ticker(QCoreApplication::instance());
+    }
+    return s_instance;
+}
+
+void Ticker::attach(TickClient *client)
+{
+    // Hand the newcomer a fresh reading so it does not start out stale.
+    read();
+    client->tick(m_snapshot);
+
+    Client entry = { client, due(client) };
+    m_clients.push_back(entry);
+    arm();
+}
+
+void Ticker::detach(TickClient *client)
+{
+    for(clientVector::iterator it(m_clients.begin());
+        it != m_clients.end(); it++) {
+        if (it->client == client) {
+            m_clients.erase(it);
+            break;
+        }
+    }
+
+    if (m_clients.empty()) {
+        m_timer.stop();
+    }
+}
+
+void Ticker::reschedule(TickClient *client)
+{
+    for(clientVector::iterator it(m_clients.begin());
+        it != m_clients.end(); it++) {
+        if (it->client == client) {
+            it->due = due(client);
+            break;
+        }
+    }
+    arm();
+}
+
+void Ticker::setTimeSource(TimeSource *source)
+{
+    delete m_source;
+    m_source = (source != NULL) ? source : new RealTimeSource;
+    refresh();
+}
+
+void Ticker::refresh()
+{
+    // The time may have jumped anywhere, bring every clock over at once.
+    read();
+    for(clientVector::iterator it(m_clients.begin());
+        it != m_clients.end(); it++) {
+        it->client->tick(m_snapshot);
+        it->due = due(it->client);
+    }
+    arm();
+}
+
+void Ticker::read()
+{
+    m_nowMsecs = m_source->now();
+    m_snapshot.update(QDateTime::fromMSecsSinceEpoch(m_nowMsecs));
+}
+
+qint64 Ticker::due(const TickClient *client) const
+{
+    return m_nowMsecs + client->dueIn(m_snapshot);
+}
+
+void Ticker::arm()
+{
+    // A time that stands still never comes due.
+    if (m_clients.empty() || m_source->rate() <= 0) {
+        m_timer.stop();
+        return;
+    }
+
+    qint64 next = m_clients.front().due;
+    for(clientVector::const_iterator it(m_clients.begin());
+        it != m_clients.end(); it++) {
+        next = std::min(next, it->due);
+    }
+
+    // The deadlines are in source time, the timer runs in real time.
+    qint64 wait = std::max(qint64(0), next - m_source->now());
+    qreal real = ceil(wait / m_source->rate());
+    real = std::min(real, qreal(std::numeric_limits<int>::max() - cDeadlineSlack));
+    m_timer.start(int(real) + cDeadlineSlack);
+}
+
+void Ticker::tick()
+{
+    m_wakeups++;
+    read();
+
+    // Publish the one snapshot to every clock that is due, the resulting
+    // updates are then painted together in the next paint pass.
+    for(clientVector::iterator it(m_clients.begin());
+        it != m_clients.end(); it++) {
+        if (it->due > m_nowMsecs) {
+            continue;
+        }
+        it->client->tick(m_snapshot);
+        it->due = due(it->client);
+    }
+
+    arm();
+}
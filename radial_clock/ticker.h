@@ -0,0 +1,109 @@
+/****************************************************************************
+**
+** Copyright (C) 2018 Brian Hill
+** All rights reserved.
+**
+** License Agreement
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** Software Author: Brian Hill <brian.hill@glowfish.ca>
+**
+** Summary: Header for the shared tick service of the radial clocks
+**
+****************************************************************************/
+
+#ifndef TICKER_H
+#define TICKER_H
+
+#include "radial_clock.h"
+#include "time_source.h"
+
+#include <QObject>
+#include <QTimer>
+#include <QDateTime>
+#include <vector>
+
+/************************************************************************
+** TickClient - Anything driven by the Ticker.
+** - tick -- Take the reading of a tick, sent once the client is due and
+**   when it attaches.
+** - dueIn -- The milliseconds from a reading until the next change the
+**   client has to show.
+************************************************************************/
+class QDESIGNER_WIDGET_EXPORT TickClient
+{
+public:
+    virtual ~TickClient();
+
+    virtual void tick(const RadialClock::TimeSnapshot &snapshot) = 0;
+    virtual int dueIn(const RadialClock::TimeSnapshot &snapshot) const = 0;
+};
+
+class Ticker : public QObject
+{
+    Q_OBJECT
+
+public:
+    ~Ticker();
+
+    /************************************************************************
+    ** The process-wide instance. It is owned by the application object and
+    ** is created on first use.
+    ************************************************************************/
+    static Ticker *instance();
+
+    /************************************************************************
+    ** Encapsulated Properties
+    ** - snapshot -- The time read on the most recent tick (Read-Only).
+    ** - wakeups -- The number of times the timer has fired (Read-Only).
+    ** - timeSource -- Where the time is read from, the system clock unless
+    **   set. The ticker takes ownership, NULL restores the system clock.
+    ************************************************************************/
+    const RadialClock::TimeSnapshot &snapshot() const { return m_snapshot; }
+    long wakeups() const { return m_wakeups; }
+    const TimeSource *timeSource() const { return m_source; }
+    void setTimeSource(TimeSource *source);
+    void refresh();
+
+    void attach(TickClient *client);
+    void detach(TickClient *client);
+    void reschedule(TickClient *client);
+
+private:
+    explicit Ticker(QObject *parent);
+
+    struct Client {
+        TickClient *client;
+        qint64 due;
+    };
+    typedef std::vector<Client> clientVector;
+
+    /************************************************************************
+    ** Internal Variables.
+    ************************************************************************/
+    static Ticker *s_instance;
+    QTimer m_timer;
+    TimeSource *m_source;
+    RadialClock::TimeSnapshot m_snapshot;
+    qint64 m_nowMsecs;
+    long m_wakeups;
+    clientVector m_clients;
+
+    void read();
+    qint64 due(const TickClient *client) const;
+    void arm();
+
+private slots:
+    void tick();
+};
+
+#endif // TICKER_H
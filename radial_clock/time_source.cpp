@@ -0,0 +1,80 @@
+/****************************************************************************
+**
+** Copyright (C) 2018 Brian Hill
+** All rights reserved.
+**
+** License Agreement
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** Software Author: Brian Hill <brian.hill@glowfish.ca>
+**
+** Summary: Time sources driving the radial clocks
+**
+****************************************************************************/
+
+#include "time_source.h"
+
+/************************************************************************
+** TimeSource
+************************************************************************/
+TimeSource::~TimeSource()
+{
+}
+
+/************************************************************************
+** RealTimeSource
+************************************************************************/
+qint64 RealTimeSource::now() const
+{
+    return QDateTime::currentMSecsSinceEpoch();
+}
+
+/************************************************************************
+** FixedTimeSource
+************************************************************************/
+FixedTimeSource::FixedTimeSource(const QDateTime &dtime) :
+    m_msecs(dtime.toMSecsSinceEpoch())
+{
+}
+
+qint64 FixedTimeSource::now() const
+{
+    return m_msecs;
+}
+
+/************************************************************************
+** OffsetTimeSource
+************************************************************************/
+OffsetTimeSource::OffsetTimeSource(qint64 offset) :
+    m_offset(offset)
+{
+}
+
+qint64 OffsetTimeSource::now() const
+{
+    return QDateTime::currentMSecsSinceEpoch() + m_offset;
+}
+
+/************************************************************************
+** AcceleratedTimeSource
+************************************************************************/
+AcceleratedTimeSource::AcceleratedTimeSource(const QDateTime &start, qreal factor) :
+    m_start(start.toMSecsSinceEpoch()),
+    m_factor(factor)
+{
+    m_elapsed.start();
+}
+
+qint64 AcceleratedTimeSource::now() const
+{
+    return m_start + qint64(m_elapsed.elapsed() * m_factor);
+}
@@ -0,0 +1,105 @@
+/****************************************************************************
+**
+** Copyright (C) 2018 Brian Hill
+** All rights reserved.
+**
+** License Agreement
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** Software Author: Brian Hill <brian.hill@glowfish.ca>
+**
+** Summary: Header for the time sources driving the radial clocks
+**
+****************************************************************************/
+
+#ifndef TIME_SOURCE_H
+#define TIME_SOURCE_H
+
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QtDesigner/QDesignerExportWidget>
+
+/************************************************************************
+** TimeSource - Where the clocks read the time from.
+** - now -- The current time, in milliseconds since the epoch.
+** - rate -- The milliseconds of source time that pass per millisecond of
+**   real time, 0 when the time stands still.
+************************************************************************/
+class QDESIGNER_WIDGET_EXPORT TimeSource
+{
+public:
+    virtual ~TimeSource();
+
+    virtual qint64 now() const = 0;
+    virtual qreal rate() const { return 1.0; }
+    QDateTime currentDateTime() const { return QDateTime::fromMSecsSinceEpoch(now()); }
+};
+
+/************************************************************************
+** RealTimeSource - The system clock.
+************************************************************************/
+class QDESIGNER_WIDGET_EXPORT RealTimeSource : public TimeSource
+{
+public:
+    qint64 now() const;
+};
+
+/************************************************************************
+** FixedTimeSource - A time that only changes when it is set.
+************************************************************************/
+class QDESIGNER_WIDGET_EXPORT FixedTimeSource : public TimeSource
+{
+public:
+    explicit FixedTimeSource(const QDateTime &dtime);
+
+    qint64 now() const;
+    qreal rate() const { return 0.0; }
+    void setTime(const QDateTime &dtime) { m_msecs = dtime.toMSecsSinceEpoch(); }
+
+private:
+    qint64 m_msecs;
+};
+
+/************************************************************************
+** OffsetTimeSource - The system clock shifted by a fixed amount.
+************************************************************************/
+class QDESIGNER_WIDGET_EXPORT OffsetTimeSource : public TimeSource
+{
+public:
+    explicit OffsetTimeSource(qint64 offset);
+
+    qint64 now() const;
+    qint64 offset() const { return m_offset; }
+
+private:
+    qint64 m_offset;
+};
+
+/************************************************************************
+** AcceleratedTimeSource - Time running FACTOR times faster than the
+** system clock, starting from START when the source is created.
+************************************************************************/
+class QDESIGNER_WIDGET_EXPORT AcceleratedTimeSource : public TimeSource
+{
+public:
+    AcceleratedTimeSource(const QDateTime &start, qreal factor);
+
+    qint64 now() const;
+    qreal rate() const { return m_factor; }
+
+private:
+    qint64 m_start;
+    qreal m_factor;
+    QElapsedTimer m_elapsed;
+};
+
+#endif // TIME_SOURCE_H
@@ -0,0 +1,108 @@
+/****************************************************************************
+**
+** Copyright (C) 2018 Brian Hill
+** All rights reserved.
+**
+** License Agreement
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** Software Author: Brian Hill <brian.hill@glowfish.ca>
+**
+** Summary: Cached UTC offset tables of the time zones
+**
+****************************************************************************/
+
+#include "zone_table.h"
+
+#include <QMutex>
+#include <QMutexLocker>
+#include <map>
+#include <algorithm>
+
+namespace {
+    // The years covered by every table.
+    const int cFirstYear = 1970;
+    const int cLastYear = 2100;
+
+    typedef std::map<QByteArray, ZoneTable*> zoneMap;
+
+    // Guards the registry, and QTimeZone which is only reentrant.
+    QMutex s_mutex;
+    zoneMap s_tables;
+}
+
+/************************************************************************
+** Constructor/Destructor
+************************************************************************/
+ZoneTable::ZoneTable(const QTimeZone &zone) :
+    m_id(zone.id()),
+    m_zone(zone)
+{
+    QDateTime from(QDate(cFirstYear, 1, 1), QTime(0, 0), Qt::UTC);
+    QDateTime to(QDate(cLastYear, 1, 1), QTime(0, 0), Qt::UTC);
+    m_from = from.toMSecsSinceEpoch();
+    m_to = to.toMSecsSinceEpoch();
+
+    // The offset in effect at the start, then every change after it.
+    Transition first = { m_from, zone.offsetFromUtc(from) };
+    m_transitions.push_back(first);
+    if (zone.hasTransitions()) {
+        QTimeZone::OffsetDataList list = zone.transitions(from, to);
+        for(QTimeZone::OffsetDataList::const_iterator it(list.begin());
+            it != list.end(); it++) {
+            Transition t = { it->atUtc.toMSecsSinceEpoch(), it->offsetFromUtc };
+            if (t.at > m_transitions.back().at) {
+                m_transitions.push_back(t);
+            }
+        }
+    }
+}
+
+const ZoneTable *ZoneTable::find(const QByteArray &id)
+{
+    QMutexLocker lock(&s_mutex);
+    zoneMap::const_iterator it = s_tables.find(id);
+    if (it != s_tables.end()) {
+        return it->second;
+    }
+
+    QTimeZone zone(id);
+    ZoneTable *table = zone.isValid() ? new ZoneTable(zone) : NULL;
+    s_tables.insert(std::make_pair(id, table));
+    return table;
+}
+
+/************************************************************************
+** Lookup
+************************************************************************/
+bool ZoneTable::before(qint64 msecs, const Transition &t)
+{
+    return msecs < t.at;
+}
+
+int ZoneTable::offsetAt(qint64 msecs) const
+{
+    if (msecs < m_from || msecs >= m_to) {
+        QMutexLocker lock(&s_mutex);
+        return m_zone.offsetFromUtc(QDateTime::fromMSecsSinceEpoch(msecs, Qt::UTC));
+    }
+
+    // The last transition at or before the instant.
+    transitionVector::const_iterator it = std::upper_bound(m_transitions.begin(), m_transitions.end(),
+                                                           msecs, before);
+    return (it - 1)->offset;
+}
+
+QDateTime ZoneTable::toLocal(qint64 msecs) const
+{
+    return QDateTime::fromMSecsSinceEpoch(msecs, Qt::OffsetFromUTC, offsetAt(msecs));
+}
@@ -0,0 +1,72 @@
+/****************************************************************************
+**
+** Copyright (C) 2018 Brian Hill
+** All rights reserved.
+**
+** License Agreement
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** Software Author: Brian Hill <brian.hill@glowfish.ca>
+**
+** Summary: Header for the cached UTC offset tables of the time zones
+**
+****************************************************************************/
+
+#ifndef ZONE_TABLE_H
+#define ZONE_TABLE_H
+
+#include <QByteArray>
+#include <QTimeZone>
+#include <vector>
+
+class ZoneTable
+{
+public:
+    /************************************************************************
+    ** The shared table of the zone with the given IANA id, built on first
+    ** use and kept for the life of the process. NULL if the id is unknown.
+    ************************************************************************/
+    static const ZoneTable *find(const QByteArray &id);
+
+    /************************************************************************
+    ** The offset from UTC (in seconds) in effect at the given instant (in
+    ** milliseconds since the epoch).
+    ** Note: instants inside the table are a binary search over the offset
+    ** transitions, anything outside of it falls back to QTimeZone.
+    ************************************************************************/
+    int offsetAt(qint64 msecs) const;
+    QDateTime toLocal(qint64 msecs) const;
+
+    const QByteArray &id() const { return m_id; }
+
+private:
+    explicit ZoneTable(const QTimeZone &zone);
+
+    struct Transition {
+        qint64 at;
+        int offset;
+    };
+    typedef std::vector<Transition> transitionVector;
+
+    static bool before(qint64 msecs, const Transition &t);
+
+    /************************************************************************
+    ** Internal Variables.
+    ************************************************************************/
+    QByteArray m_id;
+    QTimeZone m_zone;
+    qint64 m_from;
+    qint64 m_to;
+    transitionVector m_transitions;
+};
+
+#endif // ZONE_TABLE_H
@@ -0,0 +1,43 @@
+#-------------------------------------------------
+#
+# Copyright (C) 2018 Brian Hill
+# All rights reserved
+#
+# License Agreement
+#
+# This program is free software: you can distribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# any later version
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY of FITNESS FOR A PARTICULAR PURPOSE. See the
+# GNU General Public License for more details.
+#
+# Software Author: Brian Hill <brian.hill@glowfish.ca>
+#
+# Benchmarks of the slide puzzle board and tile clicks, run without a
+# display (the offscreen platform is picked unless QT_QPA_PLATFORM is set).
+# To compare builds, keep the results in a machine readable form, e.g.:
+#   ./bench_slide_puzzle -o results.xml,xml
+#
+#-------------------------------------------------
+
+QT += widgets testlib
+
+CONFIG += console release
+CONFIG -= app_bundle
+
+TARGET = bench_slide_puzzle
+TEMPLATE = app
+
+INCLUDEPATH += $$PWD/..
+DEPENDPATH += $$PWD/..
+
+SOURCES += bench_slide_puzzle.cpp \
+    ../grid.cpp \
+    ../tile.cpp
+
+HEADERS += ../grid.h \
+    ../tile.h
@@ -0,0 +1,164 @@
+/****************************************************************************
+**
+** Copyright (C) 2018 Brian Hill
+** All rights reserved.
+**
+** License Agreement
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** Software Author: Brian Hill <brian.hill@glowfish.ca>
+**
+** Summary: Benchmarks of the slide puzzle board and tile clicks
+**
+****************************************************************************/
+
+#include "grid.h"
+#include "tile.h"
+
+#include <QApplication>
+#include <QGraphicsScene>
+#include <QGraphicsSceneMouseEvent>
+#include <QElapsedTimer>
+#include <QPixmap>
+#include <QtTest>
+#include <vector>
+
+namespace {
+    // A 50x50 board of small tiles.
+    const int cSide = 50;
+    const int cTileSize = 8;
+
+    /************************************************************************
+    ** The cells the blank passes through when it sweeps the board row by
+    ** row from the bottom right, back and forth. It never comes back to a
+    ** cell, so every click moves a tile that is not animating yet.
+    ************************************************************************/
+    std::vector<int> sweep(int rows, int columns)
+    {
+        std::vector<int> cells;
+        for(int r = rows - 1; r >= 0; r--) {
+            bool left = ((rows - 1 - r) % 2 == 0);
+            for(int i = 0; i < columns; i++) {
+                int c = left ? columns - 1 - i : i;
+                cells.push_back(r*columns + c);
+            }
+        }
+        return cells;
+    }
+}
+
+class BenchSlidePuzzle : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void direction();
+    void slide();
+    void click();
+};
+
+/************************************************************************
+** Whether and where every tile of the board can move.
+************************************************************************/
+void BenchSlidePuzzle::direction()
+{
+    Grid grid;
+    grid.reset(cSide, cSide);
+
+    int movable = 0;
+    QBENCHMARK {
+        movable = 0;
+        for(int id = 0; id < grid.size(); id++) {
+            int dr = 0, dc = 0;
+            if (grid.direction(id, dr, dc)) {
+                movable++;
+            }
+        }
+    }
+    QCOMPARE(movable, 2);
+}
+
+/************************************************************************
+** A tile next to the blank slid over and back, keeping the counts of
+** the misplaced tiles and the distance up to date.
+************************************************************************/
+void BenchSlidePuzzle::slide()
+{
+    Grid grid;
+    grid.reset(cSide, cSide);
+    int id = grid.at(cSide - 1, cSide - 2);
+
+    QBENCHMARK {
+        grid.slide(id);
+        grid.slide(id);
+    }
+    QVERIFY(grid.solved());
+}
+
+/************************************************************************
+** A press on the tile next to the blank, delivered through the scene as
+** a click on the board would be: the item lookup, the move decision, the
+** grid update and the start of the animation. Each tile is clicked once,
+** so the latency is reported per click rather than from QBENCHMARK.
+************************************************************************/
+void BenchSlidePuzzle::click()
+{
+    Grid grid;
+    grid.reset(cSide, cSide);
+
+    QPixmap atlas(cSide*cTileSize, cSide*cTileSize);
+    atlas.fill(Qt::gray);
+    QGraphicsScene scene(0, 0, atlas.width(), atlas.height());
+    for(int id = 0; id < grid.size(); id++) {
+        if (id == grid.missing()) {
+            continue;
+        }
+        int r = id / cSide;
+        int c = id % cSide;
+        QRect source(c*cTileSize, r*cTileSize, cTileSize, cTileSize);
+        Tile *tile = new Tile(id, r, c, atlas, source, &grid);
+        tile->setPos(source.topLeft());
+        scene.addItem(tile);
+        connect(tile, &Tile::start, [&grid, tile]() { grid.slide(tile->id()); });
+    }
+
+    std::vector<int> cells = sweep(cSide, cSide);
+    QElapsedTimer timer;
+    timer.start();
+    for(std::vector<int>::const_iterator it(cells.begin() + 1);
+        it != cells.end(); it++) {
+        QPointF pos((*it % cSide + 0.5)*cTileSize, (*it / cSide + 0.5)*cTileSize);
+        QGraphicsSceneMouseEvent event(QEvent::GraphicsSceneMousePress);
+        event.setScenePos(pos);
+        event.setButton(Qt::LeftButton);
+        event.setButtons(Qt::LeftButton);
+        QCoreApplication::sendEvent(&scene, &event);
+    }
+    qint64 elapsed = timer.nsecsElapsed();
+
+    int clicks = int(cells.size()) - 1;
+    QCOMPARE(grid.blank(), cells.back());
+    QTest::setBenchmarkResult(qreal(elapsed)/clicks, QTest::WalltimeNanoseconds);
+}
+
+int main(int argc, char *argv[])
+{
+    // The benchmarks run without a display unless told otherwise.
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    QApplication app(argc, argv);
+    BenchSlidePuzzle bench;
+    return QTest::qExec(&bench, argc, argv);
+}
+
+#include "bench_slide_puzzle.moc"
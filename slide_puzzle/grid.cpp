@@ -0,0 +1,134 @@
+/****************************************************************************
+**
+** Copyright (C) 2018 Brian Hill
+** All rights reserved.
+**
+** License Agreement
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** Software Author: Brian Hill <brian.hill@glowfish.ca>
+**
+** Summary: Logical board of the slide puzzle
+**
+****************************************************************************/
+
+#include "grid.h"
+
+#include <stdlib.h>
+
+/************************************************************************
+** Constants
+************************************************************************/
+const int Grid::None = -1;
+
+/************************************************************************
+** Constructor/Destructor
+************************************************************************/
+Grid::Grid() :
+    m_rows(0),
+    m_columns(0),
+    m_blank(None),
+    m_missing(None),
+    m_misplaced(0),
+    m_distance(0)
+{
+}
+
+/************************************************************************
+** The Manhattan distance from a cell to the own cell of a tile.
+************************************************************************/
+int Grid::distance(int id, int cell) const
+{
+    return abs(id / m_columns - cell / m_columns) + abs(id % m_columns - cell % m_columns);
+}
+
+/************************************************************************
+** The step from a tile's cell to the blank, if the blank is next to it.
+************************************************************************/
+bool Grid::direction(int id, int &dr, int &dc) const
+{
+    int from = m_positions[id];
+    if (from == None || m_blank == None) {
+        return false;
+    }
+
+    dr = m_blank / m_columns - from / m_columns;
+    dc = m_blank % m_columns - from % m_columns;
+    return abs(dr) + abs(dc) == 1;
+}
+
+/************************************************************************
+** Lay the tiles out in order, the last one being left off the board.
+************************************************************************/
+void Grid::reset(int rows, int columns)
+{
+    QVector<int> order(rows*columns);
+    for(int i = 0; i < order.size(); i++) {
+        order[i] = i;
+    }
+
+    m_rows = rows;
+    m_columns = columns;
+    arrange(order);
+}
+
+/************************************************************************
+** Place order[i] in cell i. The tile in the last entry is left off the
+** board and its cell, the last one, becomes the blank.
+************************************************************************/
+void Grid::arrange(const QVector<int> &order)
+{
+    m_cells = order;
+    m_positions.fill(None, order.size());
+    m_blank = None;
+    m_missing = None;
+    m_misplaced = 0;
+    m_distance = 0;
+    if (order.empty()) {
+        return;
+    }
+
+    for(int i = 0; i < order.size(); i++) {
+        m_positions[order[i]] = i;
+    }
+
+    m_blank = order.size() - 1;
+    m_missing = order.last();
+    m_cells[m_blank] = None;
+    m_positions[m_missing] = None;
+
+    for(int i = 0; i < m_blank; i++) {
+        m_misplaced += (m_cells[i] != i);
+        m_distance += distance(m_cells[i], i);
+    }
+}
+
+/************************************************************************
+** Move a tile into the blank, if the blank is next to it.
+************************************************************************/
+bool Grid::slide(int id)
+{
+    int dr = 0, dc = 0;
+    if (direction(id, dr, dc) == false) {
+        return false;
+    }
+
+    int from = m_positions[id];
+    m_misplaced += (m_blank != id) - (from != id);
+    m_distance += distance(id, m_blank) - distance(id, from);
+
+    m_cells[m_blank] = id;
+    m_cells[from] = None;
+    m_positions[id] = m_blank;
+    m_blank = from;
+    return true;
+}
@@ -0,0 +1,99 @@
+/****************************************************************************
+**
+** Copyright (C) 2018 Brian Hill
+** All rights reserved.
+**
+** License Agreement
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** Software Author: Brian Hill <brian.hill@glowfish.ca>
+**
+** Summary: Header for the logical board of the slide puzzle
+**
+****************************************************************************/
+
+#ifndef GRID_H
+#define GRID_H
+
+#include <QVector>
+
+class Grid
+{
+public:
+    explicit Grid();
+    ~Grid() {}
+
+    // The content of the blank cell, and the cell of the missing tile.
+    static const int None;
+
+    /************************************************************************
+    ** Encapsulated Properties
+    ** - rows -- The number of rows of the board (Read-Only).
+    ** - columns -- The number of columns of the board (Read-Only).
+    ** - size -- The number of cells of the board (Read-Only).
+    ** - blank -- The cell left empty by the missing tile (Read-Only).
+    ** - missing -- The tile left off the board (Read-Only).
+    ** - misplaced -- The number of tiles on the board out of their cell.
+    ** - distance -- The sum of the Manhattan distances from every tile on
+    **   the board to its own cell.
+    ** - solved -- Whether or not every tile is in its own cell.
+    ** Note: a tile's id is the index of the cell it belongs to, and cells
+    ** are numbered row by row.
+    ************************************************************************/
+    int rows() const { return m_rows; }
+    int columns() const { return m_columns; }
+    int size() const { return m_cells.size(); }
+
+    int blank() const { return m_blank; }
+    int blankRow() const { return m_blank / m_columns; }
+    int blankColumn() const { return m_blank % m_columns; }
+
+    int missing() const { return m_missing; }
+
+    int misplaced() const { return m_misplaced; }
+    int distance() const { return m_distance; }
+    bool solved() const { return m_misplaced == 0; }
+
+    /************************************************************************
+    ** Lookups
+    ** - at -- The tile in a cell, or None for the blank.
+    ** - cell -- The cell holding a tile, or None for the missing tile.
+    ** - row / column -- The row and column of the cell holding a tile.
+    ************************************************************************/
+    int at(int row, int column) const { return m_cells[row*m_columns + column]; }
+    int cell(int id) const { return m_positions[id]; }
+    int row(int id) const { return m_positions[id] / m_columns; }
+    int column(int id) const { return m_positions[id] % m_columns; }
+
+    bool direction(int id, int &dr, int &dc) const;
+
+    void reset(int rows, int columns);
+    void arrange(const QVector<int> &order);
+    bool slide(int id);
+
+private:
+    /************************************************************************
+    ** Internal Variables.
+    ************************************************************************/
+    int m_rows;
+    int m_columns;
+    QVector<int> m_cells;
+    QVector<int> m_positions;
+    int m_blank;
+    int m_missing;
+    int m_misplaced;
+    int m_distance;
+
+    int distance(int id, int cell) const;
+};
+
+#endif // GRID_H
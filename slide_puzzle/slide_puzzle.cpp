@@ -26,15 +26,19 @@
 
 #include <QGraphicsView>
 #include <QPushButton>
+#include <QLabel>
 #include <QGridLayout>
+#include <QPainter>
 #include <QColormap>
 #include <QTime>
 #include <QFile>
 #include <QDirIterator>
+#include <QtConcurrent>
 #include <math.h>
 
 #include <QDebug>
 
+#include <algorithm>
 #include <iostream>
 
 namespace {
@@ -61,11 +65,31 @@ QPushButton *button(const QWidget *w)
     return static_cast<QPushButton*>(byType(w, "QPushButton"));
 }
 
+QLabel *label(const QWidget *w)
+{
+    return static_cast<QLabel*>(byType(w, "QLabel"));
+}
+
 int position(int offset, int multiple, int delta)
 {
     return offset + multiple*delta;
 }
 
+/************************************************************************
+** Draw the image over its background color, offset by the padding, on an
+** opaque image the size of the whole board.
+************************************************************************/
+QImage compose(const QImage &img, const QSize &size, const QPoint &offset, const QColor &background)
+{
+    QImage destination(size, QImage::Format_RGB32);
+    destination.fill(background);
+    QPainter p(&destination);
+    p.setCompositionMode(QPainter::CompositionMode_SourceAtop);
+    p.drawImage(offset, img);
+    p.end();
+    return destination;
+}
+
 QString getResource(QString n)
 {
     QString ref(":/images/");
@@ -95,7 +119,10 @@ SlidePuzzle::SlidePuzzle(QWidget *parent) :
     m_columns(3),
     m_imageFile(":/images/logo.png"),
     m_puzzleBackground(Qt::gray),
-    m_imageBackground(Qt::white)
+    m_imageBackground(Qt::white),
+    m_solved(false),
+    m_background(NULL),
+    m_generation(new QAtomicInt(0))
 {
     Q_INIT_RESOURCE(images);
     m_scene = new QGraphicsScene(this);
@@ -109,10 +136,22 @@ SlidePuzzle::SlidePuzzle(QWidget *parent) :
     button->setText("Reset");
     connect(button, SIGNAL(clicked()), this, SLOT(scramble()));
 
+    QLabel *label = new QLabel(this);
+    label->setAlignment(Qt::AlignCenter);
+
     QGridLayout *layout = new QGridLayout(this);
     layout->addWidget(view,0,0,-1,1);
     layout->addWidget(button,1,1,1,1);
+    layout->addWidget(label,2,1,1,1);
     setLayout(layout);
+
+    connect(&m_loader, SIGNAL(finished()), this, SLOT(loaded()));
+}
+
+SlidePuzzle::~SlidePuzzle()
+{
+    // Tell the running loads to give up, they finish on their own.
+    m_generation->fetchAndAddOrdered(1);
 }
 
 void SlidePuzzle::setRows(int r)
@@ -162,13 +201,13 @@ QString SlidePuzzle::describe() const
     props += "imageFile: " + image() + "\n";
     props += "puzzleBackground: " + puzzleBackground().name() + "\n";
     props += "imageBackground: " + imageBackground().name() + "\n";
+    props += "distance: " + QString::number(distance()) + "\n";
     return props;
 }
 
 std::ostream &SlidePuzzle::describe(std::ostream &strm) const
 {
-    QList<Tile*> t;
-    tiles(t);
+    const QList<Tile*> &t = tiles();
     for(QList<Tile*>::const_iterator it(t.begin());
         it != t.end(); it++) {
         (*it)->describe(strm);
@@ -185,36 +224,25 @@ void SlidePuzzle::resizeEvent(QResizeEvent *e)
 void SlidePuzzle::showEvent(QShowEvent *e)
 {
     Q_UNUSED(e);
-    if (populated() == false) {
+    if (populated() == false && loading() == false) {
         setup();
-        scramble();
     }
     fit();
 }
 
-void SlidePuzzle::borders(QList<QGraphicsLineItem*> &l) const
-{
-    itemsByType<QGraphicsLineItem>(l, QGraphicsLineItem::Type);
-}
-
-void SlidePuzzle::tiles(QList<Tile *> &t) const
-{
-    itemsByType<Tile>(t, Tile::Type);
-}
-
-QGraphicsRectItem *SlidePuzzle::background() const
+QPointF SlidePuzzle::cellPosition(int row, int column) const
 {
-    QList<QGraphicsRectItem*> o;
-    itemsByType<QGraphicsRectItem>(o, QGraphicsRectItem::Type);
-    return (o.empty()) ? NULL : o.first();
+    const QRectF &rect = m_scene->sceneRect();
+    const Tile *tile = m_tiles.first();
+    return QPointF(position(rect.x(), column, tile->width()),
+                   position(rect.y(), row, tile->height()));
 }
 
 void SlidePuzzle::setBorderColor(const QColor &c)
 {
     const QRectF &rect = m_scene->sceneRect();
 
-    QList<QGraphicsLineItem*> b;
-    borders(b);
+    const QList<QGraphicsLineItem*> &b = borders();
     QPen pen(c);
     int d = std::min(rect.width(), rect.height());
     for(QList<QGraphicsLineItem*>::const_iterator it(b.begin());
@@ -241,8 +269,7 @@ void SlidePuzzle::setBorderColor(const QColor &c)
 
 void SlidePuzzle::setEnabledTiles(bool e)
 {
-    QList<Tile*> t;
-    tiles(t);
+    const QList<Tile*> &t = tiles();
     for(QList<Tile*>::const_iterator it(t.begin());
         it != t.end(); it++) {
         (*it)->setBorder(e);
@@ -250,13 +277,16 @@ void SlidePuzzle::setEnabledTiles(bool e)
     }
 }
 
+void SlidePuzzle::updateDistance()
+{
+    label(this)->setText("Distance: " + QString::number(distance()));
+    emit distanceChanged(distance());
+}
+
 bool SlidePuzzle::init(bool flag)
 {
-    if (!flag && populated() == false) return false;
+    if (!flag && populated() == false && loading() == false) return false;
     setup();
-    scramble();
-    fit();
-    m_scene->update();
     return true;
 }
 
@@ -264,46 +294,117 @@ void SlidePuzzle::fit() {
     view(this)->fitInView(m_scene->sceneRect(), Qt::KeepAspectRatio);
 }
 
+/************************************************************************
+** Start loading the board on a worker thread. Until it is ready, the old
+** board stays in place with its tiles disabled, or a placeholder is shown.
+************************************************************************/
 void SlidePuzzle::setup()
+{
+    Board board;
+    board.generation = m_generation->fetchAndAddOrdered(1) + 1;
+    board.file = m_imageFile;
+    board.rows = m_rows;
+    board.columns = m_columns;
+    board.background = imageBackground();
+
+    disable();
+    setEnabledTiles(false);
+    label(this)->setText("Loading...");
+    if (populated() == false) {
+        m_scene->clear();
+        m_scene->addText("Loading...");
+    }
+    m_scene->update();
+
+    m_loader.setFuture(QtConcurrent::run(&SlidePuzzle::load, m_generation, board));
+}
+
+/************************************************************************
+** Decode the image and compose the board. This runs on a worker thread,
+** and gives up as soon as a newer load is started.
+************************************************************************/
+SlidePuzzle::Board SlidePuzzle::load(QSharedPointer<QAtomicInt> generation, Board board)
+{
+    QImage img(board.file);
+    if (img.width() == 0 || generation->load() != board.generation) {
+        return board;
+    }
+
+    int width = img.width();
+    int height = img.height();
+    int w = ceil((width+0.0)/board.columns);
+    int h = ceil((height+0.0)/board.rows);
+    board.offset = QPoint(w*board.columns - width, h*board.rows - height);
+    board.image = compose(img, QSize(w*board.columns, h*board.rows),
+                          board.offset, board.background);
+    return board;
+}
+
+void SlidePuzzle::loaded()
+{
+    // Letting go of the result below reports an empty future as finished.
+    if (m_loader.future().resultCount() == 0) {
+        return;
+    }
+
+    // Take the board out of the watcher, so the composed image is only
+    // kept until it has become the atlas.
+    Board board = m_loader.result();
+    m_loader.setFuture(QFuture<Board>());
+    if (board.generation != m_generation->load()) {
+        return;
+    }
+
+    build(board);
+    board.image = QImage();
+    scramble();
+    fit();
+    m_scene->update();
+    enable();
+}
+
+/************************************************************************
+** Swap the finished board in, in one go.
+************************************************************************/
+void SlidePuzzle::build(const Board &board)
 {
     m_scene->clear();
-    QImage img(m_imageFile);
-    if (img.width() == 0) {
+    m_background = NULL;
+    m_borders.clear();
+    m_tiles.clear();
+    m_grid.reset(0, 0);
+
+    if (board.image.isNull()) {
+        label(this)->clear();
         return;
     }
 
-    const QSize &size = img.size();
-    QImage destination(size, QImage::Format_RGB32);
-    destination.fill(imageBackground());
-    QPainter p(&destination);
-    p.setCompositionMode(QPainter::CompositionMode_SourceAtop);
-    p.drawImage(0, 0, img);
+    int dx = board.offset.x();
+    int dy = board.offset.y();
+    int width = board.image.width() - dx;
+    int height = board.image.height() - dy;
+    int w = board.image.width()/m_columns;
+    int h = board.image.height()/m_rows;
 
-    int width = size.width();
-    int height = size.height();
-    int w = ceil((width+0.0)/m_columns);
-    int h = ceil((height+0.0)/m_rows);
-    int dx = w*m_columns - width;
-    int dy = h*m_rows - height;
+    // The tiles share one pixmap and each paints its own part of it.
+    QPixmap atlas = QPixmap::fromImage(board.image);
 
     m_scene->setSceneRect(-dx, -dy, width + 2*w + 2*dx, height + 2*dy);
-    m_scene->clear();
 
     QPen backPen(puzzleBackground());
     QBrush backBrush(puzzleBackground());
-    m_scene->addRect(-dx, -dy, width+2*dx, height+2*dy, backPen, backBrush);
+    m_background = m_scene->addRect(-dx, -dy, width+2*dx, height+2*dy, backPen, backBrush);
 
     int id = 0;
     for(int r = 0; r < m_rows; r++) {
         for(int c = 0; c < m_columns; c++) {
-            QRect box(position(-dx, c, w),
-                      position(-dy, r, h),
-                      w, h);
-            Tile* tile = new Tile(id++, r, c, destination.copy(box));
+            QRect box(position(0, c, w), position(0, r, h), w, h);
+            Tile* tile = new Tile(id++, r, c, atlas, box, &m_grid);
             tile->setPos(position(-dx, c, w), position(-dy, r, h));
             m_scene->addItem(tile);
+            m_tiles.append(tile);
             connect(tile, SIGNAL(stop()), this, SLOT(validate()));
-            connect(tile, SIGNAL(start()), this, SLOT(disable()));
+            connect(tile, SIGNAL(start()), this, SLOT(slide()));
         }
     }
 
@@ -315,8 +416,10 @@ void SlidePuzzle::setup()
     Tile::borderLines(box, thick/2, lines);
     for(QList<QLineF>::const_iterator it(lines.begin());
         it != lines.end(); it++) {
-        m_scene->addLine(*it, borderPen);
+        m_borders.append(m_scene->addLine(*it, borderPen));
     }
+
+    m_grid.reset(m_rows, m_columns);
 }
 
 void SlidePuzzle::reset()
@@ -332,36 +435,34 @@ void SlidePuzzle::scramble()
     m_solved = false;
     reset();
 
-    const QRectF &rect = m_scene->sceneRect();
-
-    QList<Tile*> myTiles;
-    tiles(myTiles);
-    if (myTiles.empty()) return;
+    if (m_tiles.empty()) return;
 
-    int dx = rect.x();
-    int dy = rect.y();
-    int width = rect.width();
     qsrand(QTime::currentTime().msec());
 
-    for(int r = 0; r < m_rows; r++) {
-        for(int c = 0; c < m_columns; c++) {
-            int i = qrand() % myTiles.size();
-            QList<Tile*>::iterator it = myTiles.begin() + i;
-            Tile* tile = *it;
-            myTiles.erase(it);
-
-            int w = tile->width();
-            int h = tile->height();
-            tile->setBorder(true);
-            if (myTiles.empty()) {
-                tile->setPos(width-w, position(dy, m_rows-1, h));
-                tile->setActive(false);
-                tile->setEnabled(false);
-            } else {
-                tile->setActive(true);
-                tile->setEnabled(true);
-                tile->setPos(position(dx, c, w), position(dy, r, h));
-            }
+    // Pick a random tile for every cell, the last one picked is left out.
+    QVector<int> order(m_tiles.size());
+    for(int i = 0; i < order.size(); i++) {
+        order[i] = i;
+    }
+    for(int i = order.size() - 1; i > 0; i--) {
+        std::swap(order[i], order[qrand() % (i + 1)]);
+    }
+    m_grid.arrange(order);
+    updateDistance();
+
+    int width = m_scene->sceneRect().width();
+    for(QList<Tile*>::const_iterator it(m_tiles.begin());
+        it != m_tiles.end(); it++) {
+        Tile *tile = *it;
+        tile->setBorder(true);
+        if (tile->id() == m_grid.missing()) {
+            tile->setPos(width-tile->width(), cellPosition(m_rows-1, 0).y());
+            tile->setActive(false);
+            tile->setEnabled(false);
+        } else {
+            tile->setActive(true);
+            tile->setEnabled(true);
+            tile->setPos(cellPosition(m_grid.row(tile->id()), m_grid.column(tile->id())));
         }
     }
 
@@ -371,32 +472,27 @@ void SlidePuzzle::scramble()
 
 void SlidePuzzle::validate()
 {
-    Tile* missing = NULL;
-    QList<Tile*> t;
-    tiles(t);
-    for(QList<Tile*>::const_iterator it(t.begin());
-        it != t.end(); it++) {
-        Tile *tile = *it;
-        if (tile->valid() == false) {
-            enable();
-            return;
-        }
-        if (tile->isEnabled() == false) {
-            missing = tile;
-        }
+    if (m_grid.solved() == false) {
+        enable();
+        return;
     }
 
-    const QRectF &rect = m_scene->sceneRect();
-    int dx = rect.x();
-    int dy = rect.y();
-    int w = missing->width();
-    int h = missing->height();
-
-    int sx = (position(dx, missing->column(), w)-missing->x());
-    int sy = (position(dy, missing->row(), h)-missing->y());
+    Tile *missing = m_tiles[m_grid.missing()];
+    QPointF home = cellPosition(missing->row(), missing->column());
+    int sx = home.x() - missing->x();
+    int sy = home.y() - missing->y();
     missing->shift(sx, sy, this, SLOT(pass()));
 
-    m_solved = true;    
+    m_solved = true;
+}
+
+void SlidePuzzle::slide()
+{
+    Tile *tile = qobject_cast<Tile*>(sender());
+    if (tile != NULL && m_grid.slide(tile->id())) {
+        updateDistance();
+    }
+    disable();
 }
 
 void SlidePuzzle::enable()
@@ -25,10 +25,15 @@
 #define SLIDE_PUZZLE_H
 
 #include "tile.h"
+#include "grid.h"
 
 #include <QWidget>
 #include <QtDesigner/QDesignerExportWidget>
 #include <QGraphicsScene>
+#include <QImage>
+#include <QFutureWatcher>
+#include <QAtomicInt>
+#include <QSharedPointer>
 
 class QDESIGNER_WIDGET_EXPORT SlidePuzzle : public QWidget
 {
@@ -38,10 +43,11 @@ class QDESIGNER_WIDGET_EXPORT SlidePuzzle : public QWidget
     Q_PROPERTY(QString image READ image WRITE setImage);
     Q_PROPERTY(QColor puzzleBackground READ puzzleBackground WRITE setPuzzleBackground);
     Q_PROPERTY(QColor imageBackground READ imageBackground WRITE setImageBackground);
+    Q_PROPERTY(int distance READ distance NOTIFY distanceChanged);
 
 public:
     explicit SlidePuzzle(QWidget *parent = 0);
-    ~SlidePuzzle() {}
+    ~SlidePuzzle();
 
     /************************************************************************
     ** Encapsulated Properties
@@ -49,6 +55,8 @@ public:
     ** - columns -- The number of columns to create.
     ** - image -- The image file to use.
     ** - background -- The background color to use for the puzzle.
+    ** - distance -- The number of moves left to solve the puzzle, if every
+    **   tile could slide straight to its own cell (Read-Only).
     ************************************************************************/
     int rows() const { return m_rows; }
     void setRows(int r);
@@ -65,6 +73,8 @@ public:
     const QColor &imageBackground() const { return m_imageBackground; }
     void setImageBackground(const QColor &c);
 
+    int distance() const { return m_grid.distance(); }
+
     bool solved() const { return m_solved; }
 
     QString describe() const;
@@ -89,34 +99,61 @@ private:
     QGraphicsScene *m_scene;
     bool m_solved;
 
-    template<typename C>
-    void itemsByType(QList<C*> &o, int t) const {
-        QList<QGraphicsItem*> items = m_scene->items(m_scene->sceneRect());
-        for(QList<QGraphicsItem*>::const_iterator it(items.begin());
-            it != items.end(); it++) {
-            QGraphicsItem *item = *it;
-            if (item->type() != t) continue;
-            o.push_back(static_cast<C*>(item));
-        }
-    }
-
-    void borders(QList<QGraphicsLineItem*> &l) const;
-    void tiles(QList<Tile*> &t) const;
-    QGraphicsRectItem *background() const;
+    Grid m_grid;
+    QGraphicsRectItem *m_background;
+    QList<QGraphicsLineItem*> m_borders;
+    QList<Tile*> m_tiles;
+
+    /************************************************************************
+    ** Board - The image of the whole board, composed on a worker thread.
+    ** The image is left null if it could not be loaded, or if a newer load
+    ** was started in the meantime. The generation counter is shared with
+    ** the workers, so a worker still running after the puzzle is gone
+    ** only ever touches its own copy of the board and the counter.
+    ************************************************************************/
+    struct Board {
+        int generation;
+        QString file;
+        int rows;
+        int columns;
+        QColor background;
+        QImage image;
+        QPoint offset;
+    };
+
+    QSharedPointer<QAtomicInt> m_generation;
+    QFutureWatcher<Board> m_loader;
+
+    static Board load(QSharedPointer<QAtomicInt> generation, Board board);
+    void build(const Board &board);
+
+    const QList<QGraphicsLineItem*> &borders() const { return m_borders; }
+    const QList<Tile*> &tiles() const { return m_tiles; }
+    QGraphicsRectItem *background() const { return m_background; }
+    QPointF cellPosition(int row, int column) const;
 
     void setBorderColor(const QColor &c);
     void setEnabledTiles(bool e);
+    void updateDistance();
 
-    bool populated() { return background() != NULL; }
+    bool populated() const { return background() != NULL; }
+    bool loading() const { return m_loader.isRunning(); }
     bool init(bool f);
     void fit();
     void setup();
     void reset();
 
 
+signals:
+    void distanceChanged(int d);
+
 public slots:
     void scramble();
     void validate();
+
+private slots:
+    void slide();
+    void loaded();
     void enable();
     void disable();
     void pass();
@@ -21,7 +21,7 @@
 #
 #-------------------------------------------------
 
-QT       += widgets designer
+QT       += widgets designer concurrent
 
 CONFIG += plugin release
 
@@ -33,11 +33,13 @@ TEMPLATE = lib
 
 SOURCES += slide_puzzle.cpp \
     slide_puzzle_plugin.cpp \
-    tile.cpp
+    tile.cpp \
+    grid.cpp
 
 HEADERS  += slide_puzzle.h \
     slide_puzzle_plugin.h \
-    tile.h
+    tile.h \
+    grid.h
 
 DISTFILES += \
     slide_puzzle.json
@@ -22,6 +22,7 @@
 ****************************************************************************/
 
 #include "tile.h"
+#include "grid.h"
 
 #include <QPainter>
 #include <QTimeLine>
@@ -37,12 +38,15 @@ const int Tile::Type = QGraphicsItem::UserType+1;
 /************************************************************************
 ** Constructor/Destructor
 ************************************************************************/
-Tile::Tile(int id, int row, int column, const QImage &image) :
+Tile::Tile(int id, int row, int column, const QPixmap &atlas, const QRect &source,
+           const Grid *grid) :
     m_id(id),
     m_row(row),
     m_column(column),
-    m_image(image),
-    m_animation(0)
+    m_atlas(atlas),
+    m_source(source),
+    m_animation(0),
+    m_grid(grid)
 {
     setActive(true);
     setVisible(true);
@@ -72,12 +76,12 @@ int Tile::acolumn() const {
 
 int Tile::width() const
 {
-    return m_image.size().width();
+    return m_source.width();
 }
 
 int Tile::height() const
 {
-    return m_image.size().height();
+    return m_source.height();
 }
 
 QPointF Tile::center() const
@@ -148,6 +152,11 @@ void Tile::mousePressEvent(QGraphicsSceneMouseEvent *event)
 {
     Q_UNUSED(event);
 
+    // The grid already holds the tile in its new cell.
+    if (m_timeLine.state() == QTimeLine::Running) {
+        return;
+    }
+
     int xf = 0, yf = 0;
     if (neighbor(xf, yf) == false) {
         return;
@@ -161,7 +170,7 @@ void Tile::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWid
 {
     Q_UNUSED(option);
     Q_UNUSED(widget);
-    painter->drawImage(0, 0, m_image);
+    painter->drawPixmap(QPointF(0, 0), m_atlas, m_source);
     if (border()) {  
         QPen pen(Qt::black);
         int thick = std::min(width(), height())/30;
@@ -179,47 +188,7 @@ void Tile::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWid
 
 bool Tile::neighbor(int &xf, int &yf) const
 {
-    QGraphicsScene *scene = this->scene();
-    int w = width();
-    int h = height();
-    int x = this->x() + w/2;
-    int y = this->y() + h/2;
-    QTransform transform;
-
-    const QRectF &border = scene->sceneRect();
-    int L = border.x();
-    int R = L + border.width() - 2*w;
-    int T = border.y();
-    int B = T + border.height();
-
-    for(xf = -1; xf < 2; xf ++) {
-        for(yf = -1; yf < 2; yf ++) {
-            if (xf == 0 && yf == 0) continue;
-            if (xf != 0 && yf != 0) continue;
-            if (xf == -1 && (x - w) < L) continue;
-            if (yf == -1 && (y - h) < T) continue;
-            if (xf == 1 && (x + w) > R) continue;
-            if (yf == 1 && (y + h) > B) continue;
-            QList<QGraphicsItem*> items = scene->items(QPointF(x + xf*w, y + yf*h));
-            if (items.empty()) {
-                return true;
-            }
-            bool found = false;
-            for(QList<QGraphicsItem*>::const_iterator it(items.cbegin());
-                it != items.cend(); it++) {
-                QGraphicsItem* item = *it;
-                if (item->type() == Tile::Type) {
-                    found = true;
-                    break;
-                }
-            }
-            if (!found) {
-                return true;
-            }
-        }
-    }
-
-    return false;
+    return m_grid->direction(m_id, yf, xf);
 }
 
 void Tile::cleanAnimation()
@@ -26,18 +26,22 @@
 
 #include <QObject>
 #include <QGraphicsItem>
+#include <QPixmap>
 #include <QTimeLine>
 #include <QGraphicsItemAnimation>
 
 #include <iostream>
 
+class Grid;
+
 class Tile : public QObject, public QGraphicsItem
 {
     Q_OBJECT
     Q_INTERFACES(QGraphicsItem)
 
 public:
-    explicit Tile(int id, int row, int column, const QImage &image);
+    explicit Tile(int id, int row, int column, const QPixmap &atlas, const QRect &source,
+                  const Grid *grid);
     ~Tile();
 
     static const int Type;
@@ -45,6 +49,7 @@ public:
 
     /************************************************************************
     ** Encapsulated Properties
+    ** - id -- The identifier of the tile, also its cell on the grid (Read-Only).
     ** - row -- The intended row of the tile (Read-Only).
     ** - column -- The intended column of the tile (Read-Only).
     ** - arow -- The actual row of the tile (Read-Only).
@@ -56,6 +61,7 @@ public:
     ** - origin -- The origin of the tile (Read-Only).
     ** - valid -- Whether or not the tile is in the correct postion.
     ************************************************************************/
+    int id() const { return m_id; }
     int row() const { return m_row; }
     int column() const { return m_column; }
     int arow() const;
@@ -102,9 +108,11 @@ private:
     bool m_border;
     int m_row;
     int m_column;
-    QImage m_image;
+    QPixmap m_atlas;
+    QRect m_source;
     QTimeLine m_timeLine;
     QGraphicsItemAnimation *m_animation;
+    const Grid *m_grid;
 
     QTimeLine *timeLine() { return &m_timeLine; }
 